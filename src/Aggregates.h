@@ -0,0 +1,172 @@
+//
+//      File     : Aggregates.h
+//      Abstract : Aggregates over all m-element subsets of a weighted
+//      set computed without enumerating them. The sum over all subsets
+//      of the product of their weights is the elementary symmetric
+//      polynomial e_m, which the recurrence e_k(w_1..w_i) =
+//      e_k(w_1..w_i-1) + w_i e_k-1(w_1..w_i-1), the weighted form of
+//      C(n,m) = C(n-1,m) + C(n-1,m-1), gives in O(n*m). Sums, their
+//      mean and their variance have closed forms.
+//
+
+#ifndef AGGREGATES_H
+#define AGGREGATES_H
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "Combinations.h"
+#include "TraceScope.h"
+
+namespace combinations {
+
+//      Class    : Aggregates
+//      Abstract : Aggregates of a weight vector. W must be wide enough
+//      for the results; with integer weights sums of products grow
+//      like C(n, m) max(w)^m, so double or long double suit large
+//      sets. Means and variances are computed in double. The weights
+//      are copied, so later changes to the caller's vector don't make
+//      the results disagree.
+template <class W = double>
+class Aggregates {
+public:
+  using Weights = std::vector<W>;
+
+  Aggregates(const Weights &weights); // CTOR
+  ~Aggregates() = default; // DTOR
+
+  std::vector<W> elementary(size_t m) const;
+  W sumOfProducts(size_t m) const { return elementary(m)[m]; };
+  W sumOfSums(size_t m) const;
+  double mean(size_t m) const;
+  double variance(size_t m) const;
+
+  Aggregates(const Aggregates &) = delete; // Copy CTOR
+  Aggregates &operator=(const Aggregates &) = delete; // Copy assignment
+  Aggregates(Aggregates &&) = delete; // Move CTOR
+  Aggregates &operator=(Aggregates &&) = delete; // Move assignment
+private:
+  void check(size_t m) const;
+
+  const Weights _weights;
+  W _sum;
+  double _mean; // Mean weight.
+  double _squares; // Sum of squared deviations from the mean weight.
+}; // Aggregates
+
+
+//      Function : Aggregates::Aggregates
+//      Abstract : Sum the weights and, in a second pass for accuracy,
+//      their squared deviations from the mean.
+template <class W>
+Aggregates<W>::Aggregates(const Weights &weights) :
+  _weights(weights), _sum(), _mean(0.0), _squares(0.0)
+{
+  for (const W &w : _weights) {
+    _sum += w;
+  } // for each weight
+  if (! _weights.empty()) {
+    _mean = double(_sum) / double(_weights.size());
+  } // if
+  for (const W &w : _weights) {
+    _squares += (double(w) - _mean) * (double(w) - _mean);
+  } // for each weight
+} // Aggregates::Aggregates
+
+
+//      Function : Aggregates::elementary
+//      Abstract : e_0, ..., e_m of the weights: e_k is the sum over all
+//      k-subsets of the product of their weights, and e_0 = 1. Each
+//      weight updates the row from the top down, so one row suffices.
+template <class W>
+std::vector<W>
+Aggregates<W>::elementary(const size_t m) const
+{
+  COMBINATIONS_TRACE_SCOPE("Aggregates::elementary");
+  check(m);
+  std::vector<W> e(m + 1, W());
+  e[0] = W(1);
+  for (size_t i = 0; i < _weights.size(); ++i) {
+    for (size_t k = std::min(m, i + 1); k > 0; --k) {
+      e[k] += _weights[i] * e[k-1];
+    } // for
+  } // for each weight
+  return e;
+} // Aggregates::elementary
+
+
+//      Function : Aggregates::sumOfSums
+//      Abstract : Sum over all m-subsets of their weight sums. Each
+//      weight is in C(n-1, m-1) of them. Integer types use binomial(),
+//      which throws if it overflows; others build the binomial in W
+//      so that it may exceed size_t.
+template <class W>
+W
+Aggregates<W>::sumOfSums(const size_t m) const
+{
+  check(m);
+  if (m == 0) {
+    return W();
+  } // if
+  size_t n = _weights.size() - 1;
+  if constexpr (std::is_integral_v<W>) {
+    return W(binomial(n, m - 1)) * _sum;
+  } else {
+    size_t k = std::min(m - 1, n - (m - 1));
+    W coefficient(1);
+    for (size_t i = 1; i <= k; ++i) {
+      coefficient = coefficient * W(n - k + i) / W(i);
+    } // for
+    return coefficient * _sum;
+  } // if
+} // Aggregates::sumOfSums
+
+
+//      Function : Aggregates::mean
+//      Abstract : Mean weight sum of an m-subset: m times the mean
+//      weight.
+template <class W>
+double
+Aggregates<W>::mean(const size_t m) const
+{
+  check(m);
+  return double(m) * _mean;
+} // Aggregates::mean
+
+
+//      Function : Aggregates::variance
+//      Abstract : Variance of the weight sum of a uniformly chosen
+//      m-subset, i.e. of sampling without replacement:
+//      m s^2 (n-m) / (n-1) with s^2 the population variance of the
+//      weights.
+template <class W>
+double
+Aggregates<W>::variance(const size_t m) const
+{
+  check(m);
+  size_t n = _weights.size();
+  if (n < 2) {
+    return 0.0;
+  } // if
+  return double(m) * (_squares / double(n)) * double(n - m) /
+    double(n - 1);
+} // Aggregates::variance
+
+
+//      Function : Aggregates::check
+//      Abstract : Reject subset sizes larger than the set.
+template <class W>
+void
+Aggregates<W>::check(const size_t m) const
+{
+  if (m > _weights.size()) {
+    throw std::invalid_argument("Subset size exceeds set size.");
+  } // if
+} // Aggregates::check
+
+} // namespace combinations
+
+#endif // AGGREGATES_H
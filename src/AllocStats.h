@@ -0,0 +1,247 @@
+//
+//      File     : AllocStats.h
+//      Abstract : Opt-in allocation tracking for test and benchmark
+//      executables. When ALLOC_STATS is defined, this header replaces
+//      the global operator new and delete, including the aligned and
+//      non-throwing forms, with counting versions, so it must be
+//      included by exactly one translation unit of the executable.
+//      Otherwise all statistics read as zero.
+//
+
+#ifndef ALLOCSTATS_H
+#define ALLOCSTATS_H
+
+#include <atomic>
+#include <cstddef>
+
+#ifdef ALLOC_STATS
+#include <malloc.h>
+
+#include <cstdlib>
+#include <new>
+#endif
+
+namespace alloc {
+
+#ifdef ALLOC_STATS
+constexpr bool enabled = true;
+#else
+constexpr bool enabled = false;
+#endif
+
+// Totals maintained by the operator new/delete replacements.
+inline std::atomic<size_t> allocCount(0);
+inline std::atomic<size_t> allocBytes(0);
+inline std::atomic<size_t> liveBytes(0);
+inline std::atomic<size_t> peakBytes(0);
+
+
+//      Struct   : Stats
+//      Abstract : Allocation counts over some interval.
+struct Stats {
+  size_t count = 0;
+  size_t bytes = 0;
+}; // Stats
+
+
+//      Function : snapshot
+//      Abstract : Current allocation totals.
+inline Stats
+snapshot()
+{
+  return Stats{allocCount.load(std::memory_order_relaxed),
+               allocBytes.load(std::memory_order_relaxed)};
+} // snapshot
+
+
+//      Function : resetPeak
+//      Abstract : Restart peak tracking from the current live bytes,
+//      which are returned.
+inline size_t
+resetPeak()
+{
+  size_t live = liveBytes.load();
+  peakBytes.store(live);
+  return live;
+} // resetPeak
+
+
+//      Class    : Tally
+//      Abstract : Accumulates allocations over a number of
+//      operations, e.g. calls of Enumerator::next.
+class Tally {
+public:
+  Tally() = default; // CTOR
+  ~Tally() = default; // DTOR
+
+  void add(const Stats &before, const Stats &after) {
+    _stats.count += after.count - before.count;
+    _stats.bytes += after.bytes - before.bytes;
+    ++_ops;
+  }; // add
+
+  size_t ops() const { return _ops; };
+  double countPerOp() const { return _ops ? double(_stats.count)/_ops : 0; };
+  double bytesPerOp() const { return _ops ? double(_stats.bytes)/_ops : 0; };
+private:
+  Stats _stats;
+  size_t _ops = 0;
+}; // Tally
+
+
+//      Class    : Scope
+//      Abstract : Adds the allocations made during its lifetime as
+//      one operation of a Tally.
+class Scope {
+public:
+  Scope(Tally &tally) :
+    _tally(tally), _before(snapshot()) {}; // CTOR
+  ~Scope() { _tally.add(_before, snapshot()); }; // DTOR
+
+  Scope(const Scope &) = delete; // Copy CTOR
+  Scope &operator=(const Scope &) = delete; // Copy assignment
+  Scope(Scope &&) = delete; // Move CTOR
+  Scope &operator=(Scope &&) = delete; // Move assignment
+private:
+  Tally &_tally;
+  Stats _before;
+}; // Scope
+
+} // namespace alloc
+
+
+#ifdef ALLOC_STATS
+
+namespace alloc {
+namespace detail {
+
+//      Function : allocate
+//      Abstract : Allocate and count size bytes with the given
+//      alignment, or return nullptr. Over-aligned sizes are rounded up
+//      to a multiple of the alignment for aligned_alloc.
+inline void *
+allocate(size_t size, size_t align)
+{
+  if (size == 0) {
+    size = 1;
+  } // if
+  void *ptr = align <= __STDCPP_DEFAULT_NEW_ALIGNMENT__ ? std::malloc(size) :
+    std::aligned_alloc(align, (size + align - 1) / align * align);
+  if (! ptr) {
+    return nullptr;
+  } // if
+  size_t usable = malloc_usable_size(ptr);
+  allocCount.fetch_add(1, std::memory_order_relaxed);
+  allocBytes.fetch_add(size, std::memory_order_relaxed);
+  size_t live =
+    liveBytes.fetch_add(usable, std::memory_order_relaxed) + usable;
+  size_t peak = peakBytes.load(std::memory_order_relaxed);
+  while (live > peak &&
+         ! peakBytes.compare_exchange_weak(peak, live,
+                                           std::memory_order_relaxed)) {
+  } // while
+  return ptr;
+} // allocate
+
+
+} // namespace detail
+} // namespace alloc
+
+
+//      Function : operator new
+//      Abstract : Counting replacement for the global allocator.
+void *
+operator new(size_t size)
+{
+  void *ptr = alloc::detail::allocate(size, 0);
+  if (! ptr) {
+    throw std::bad_alloc();
+  } // if
+  return ptr;
+} // operator new
+
+
+//      Function : operator new
+//      Abstract : Counting replacement for the aligned allocator, which
+//      std::pmr::new_delete_resource uses.
+void *
+operator new(size_t size, std::align_val_t align)
+{
+  void *ptr = alloc::detail::allocate(size, size_t(align));
+  if (! ptr) {
+    throw std::bad_alloc();
+  } // if
+  return ptr;
+} // operator new
+
+
+//      Function : operator new
+//      Abstract : Non-throwing versions return nullptr on failure.
+void *
+operator new(size_t size, const std::nothrow_t &) noexcept
+{
+  return alloc::detail::allocate(size, 0);
+} // operator new
+
+
+void *
+operator new(size_t size, std::align_val_t align,
+             const std::nothrow_t &) noexcept
+{
+  return alloc::detail::allocate(size, size_t(align));
+} // operator new
+
+
+//      Function : operator delete
+//      Abstract : Counting replacement for the global deallocator.
+void
+operator delete(void *ptr) noexcept
+{
+  if (ptr) {
+    alloc::liveBytes.fetch_sub(malloc_usable_size(ptr),
+                               std::memory_order_relaxed);
+    std::free(ptr);
+  } // if
+} // operator delete
+
+
+//      Function : operator delete
+//      Abstract : The sized, aligned and non-throwing versions share
+//      one heap and forward to the unsized version.
+void
+operator delete(void *ptr, size_t) noexcept
+{
+  operator delete(ptr);
+} // operator delete
+
+
+void
+operator delete(void *ptr, std::align_val_t) noexcept
+{
+  operator delete(ptr);
+} // operator delete
+
+
+void
+operator delete(void *ptr, size_t, std::align_val_t) noexcept
+{
+  operator delete(ptr);
+} // operator delete
+
+
+void
+operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+  operator delete(ptr);
+} // operator delete
+
+
+void
+operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept
+{
+  operator delete(ptr);
+} // operator delete
+
+#endif // ALLOC_STATS
+
+#endif // ALLOCSTATS_H
@@ -0,0 +1,870 @@
+//
+//      File     : Bench.cc
+//      Abstract : Micro-benchmarks for the combination classes.
+//
+
+#include "AllocStats.h"
+#include "Args.h"
+#include "PerfCounters.h"
+
+#include <Aggregates.h>
+#include <Combinations.h>
+#include <Constrained.h>
+#include <HugePages.h>
+#include <Kernels.h>
+#include <LocalSearch.h>
+#include <Masks.h>
+#include <SubsetSum.h>
+#include <Tiles.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory_resource>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+//      Struct   : BenchArgs
+//      Abstract : Command line arguments for the benchmark driver.
+struct BenchArgs : public argparse::Args {
+  std::vector<size_t> &nSizes = kwarg("n,n_sizes",
+                                      "comma separated set sizes.").
+    set_default("16,20,24,28");
+  std::vector<size_t> &mSizes = kwarg("m,m_sizes",
+                                      "comma separated subset sizes.").
+    set_default("2,3,4,6,8");
+  std::vector<std::string> &engines = kwarg("e,engines",
+                                            "comma separated engines.").
+    set_default("enumerator,fixed,next,best-first,lexor,lexor-sbo,"
+                "generator,generator-sbo,generator-arena,generator-trie,"
+                "trie-get,random,random-huge,tiles-lex,tiles,"
+                "tiles-parallel,subset-sum,swaps,aggregates,constrained,"
+                "counter,kernels");
+  size_t &limit = kwarg("l,limit", "combination limit per run.").
+    set_default(1<<24);
+  double &minTime = kwarg("t,min_time", "minimum seconds per benchmark.").
+    set_default(0.1);
+  std::string &json = kwarg("j,json", "JSON output file.").
+    set_default("bench.json");
+  size_t &repetitions = kwarg("r,repetitions",
+                              "timed repetitions per benchmark.").
+    set_default(1);
+  std::string &baseline = kwarg("b,baseline",
+                                "compare against this JSON baseline.").
+    set_default("");
+  double &threshold = kwarg("threshold",
+                            "minimum relative slowdown to flag.").
+    set_default(0.05);
+  double &noiseFactor = kwarg("noise_factor",
+                              "standard deviations of noise tolerated.").
+    set_default(3.0);
+  uint32_t &block = kwarg("block", "tile block size of the tiles engines.").
+    set_default(256);
+  unsigned &threads = kwarg("threads",
+                            "threads of tiles-parallel; 0 for all.").
+    set_default(0);
+
+  void prolog() override {
+    std::cout << "Benchmark combination classes." << std::endl;
+  } // prolog
+}; // BenchArgs
+
+
+//      Struct   : BenchResult
+//      Abstract : Measurements for one (engine, n, m) point. Counter
+//      results are per count() call rather than per combination. The
+//      timing is the median over the repetitions and the relative
+//      standard deviation across repetitions estimates the noise.
+struct BenchResult {
+  std::string engine;
+  size_t n = 0;
+  size_t m = 0;
+  size_t combinations = 0;
+  size_t iterations = 0;
+  double seconds = 0.0;
+  size_t allocs = 0;
+  size_t bytes = 0;
+  size_t peakBytes = 0;
+  perf::Counters::Values counters;
+  std::vector<double> samples; // ns/comb of each repetition.
+  double nsMedian = 0.0;
+  double relStddev = 0.0;
+
+  double items() const { return double(combinations) * iterations; };
+  double nsPerComb() const { return nsMedian; };
+  double combsPerSec() const { return 1e9 / nsMedian; };
+  double allocsPerComb() const { return allocs / items(); };
+  double bytesPerComb() const { return bytes / items(); };
+  double perComb(perf::Counters::Event ev) const {
+    return counters[ev] < 0 ? -1.0 : counters[ev] / items(); };
+}; // BenchResult
+
+
+// Keeps the optimizer from discarding benchmark loops.
+static volatile size_t sink = 0;
+
+
+//      Function : hwCounters
+//      Abstract : The hardware counters shared by all benchmarks.
+perf::Counters &
+hwCounters()
+{
+  static perf::Counters counters;
+  return counters;
+} // hwCounters
+
+
+//      Function : summarize
+//      Abstract : Compute the median and relative standard deviation
+//      of the repetition samples.
+void
+summarize(BenchResult &result)
+{
+  std::vector<double> sorted(result.samples);
+  std::sort(sorted.begin(), sorted.end());
+  size_t k = sorted.size();
+  result.nsMedian = (sorted[(k-1)/2] + sorted[k/2]) / 2;
+
+  double mean = std::accumulate(sorted.begin(), sorted.end(), 0.0) / k;
+  double var = 0.0;
+  for (double x : sorted) {
+    var += (x - mean) * (x - mean);
+  } // for each sample
+  result.relStddev = k > 1 ? std::sqrt(var / (k-1)) / mean : 0.0;
+} // summarize
+
+
+//      Function : measure
+//      Abstract : For each repetition, repeat pass() until at least
+//      minTime seconds have elapsed. Each pass returns the number of
+//      items it processed.
+template <class Fn>
+void
+measure(BenchResult &result, const BenchArgs &args, Fn pass)
+{
+  using Clock = std::chrono::steady_clock;
+  pass(); // Warm up.
+
+  size_t live0 = alloc::resetPeak();
+  alloc::Stats before = alloc::snapshot();
+  hwCounters().start();
+  for (size_t rep = 0; rep < std::max<size_t>(args.repetitions, 1); ++rep) {
+    auto start = Clock::now();
+    std::chrono::duration<double> elapsed(0);
+    size_t iterations = 0;
+    do {
+      result.combinations = pass();
+      ++iterations;
+      elapsed = Clock::now() - start;
+    } while (elapsed.count() < args.minTime);
+    result.iterations += iterations;
+    result.seconds += elapsed.count();
+    result.samples.push_back(elapsed.count() * 1e9 /
+                             (double(result.combinations) * iterations));
+  } // for each repetition
+  result.counters = hwCounters().stop();
+  summarize(result);
+
+  alloc::Stats after = alloc::snapshot();
+  result.allocs = after.count - before.count;
+  result.bytes = after.bytes - before.bytes;
+  result.peakBytes = alloc::peakBytes.load() - live0;
+} // measure
+
+
+//      Function : benchKernel
+//      Abstract : Run one kernel of a variant over all combinations.
+void
+benchKernel(BenchResult &result,
+            const combinations::kernels::KernelTable &kernels,
+            const std::string &kernel,
+            uint32_t n,
+            uint32_t m,
+            const BenchArgs &args)
+{
+  size_t total = combinations::Counter().count(n, m);
+  std::vector<uint32_t> idx(m), buf(256 * m);
+  auto restart = [&]() { std::iota(idx.begin(), idx.end(), 0); };
+  if (kernel == "successor") {
+    measure(result, args, [&]() {
+      restart();
+      size_t cnt = 1;
+      while (kernels.successor(idx.data(), m, n)) {
+        ++cnt;
+      } // while
+      sink = sink + idx[0];
+      return cnt;
+    });
+  } else if (kernel == "unrank") {
+    measure(result, args, [&]() {
+      for (size_t i = 0; i < total; ++i) {
+        kernels.unrank(i, total, n, m, idx.data());
+        sink = sink + idx[0];
+      } // for
+      return total;
+    });
+  } else if (kernel == "mask") {
+    measure(result, args, [&]() {
+      restart();
+      size_t cnt = 0;
+      do {
+        cnt += kernels.fromMask(kernels.toMask(idx.data(), m), buf.data());
+      } while (kernels.successor(idx.data(), m, n));
+      sink = sink + buf[0];
+      return cnt / m;
+    });
+  } else if (kernel == "frommasks") {
+    // Decode the masks of up to 64K combinations into indices.
+    std::vector<uint64_t> masks;
+    restart();
+    do {
+      masks.push_back(kernels.toMask(idx.data(), m));
+    } while (masks.size() < 65536 && kernels.successor(idx.data(), m, n));
+    std::vector<uint32_t> indices(masks.size() * m +
+                                  combinations::kernels::FROM_MASKS_SLACK);
+    measure(result, args, [&]() {
+      size_t cnt = kernels.fromMasks(masks.data(), masks.size(),
+                                     indices.data());
+      sink = sink + indices[cnt - 1];
+      return masks.size();
+    });
+  } else if (kernel == "masked") {
+    // The m-subsets of n bits spread over 64, scattered with PDEP.
+    uint64_t mask = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+      mask |= uint64_t(1) << (i * 64 / n);
+    } // for
+    combinations::MaskEnumerator masks(mask, m, kernels);
+    std::vector<uint64_t> subsets(256);
+    measure(result, args, [&]() {
+      sink = sink + masks.first();
+      size_t cnt = 1;
+      while (size_t got = masks.batch(subsets.data(), subsets.size())) {
+        cnt += got;
+        sink = sink + subsets[0];
+      } // while
+      return cnt;
+    });
+  } else {
+    measure(result, args, [&]() {
+      restart();
+      size_t cnt = 1;
+      while (size_t got = kernels.batch(idx.data(), m, n, buf.data(), 256)) {
+        cnt += got;
+        sink = sink + buf[0];
+      } // while
+      return cnt;
+    });
+  } // if
+} // benchKernel
+
+
+//      Function : benchRandom
+//      Abstract : Generate all combinations into an arena over
+//      upstream, then time reads of them in pseudo-random order.
+//      Each pass reads as many combinations as there are.
+void
+benchRandom(BenchResult &result,
+            const std::vector<int> &set,
+            size_t m,
+            const BenchArgs &args,
+            std::pmr::memory_resource *upstream)
+{
+  using Comb = combinations::pmr::Combination<int>;
+  std::pmr::monotonic_buffer_resource arena(upstream);
+  std::pmr::vector<int> arenaSet(set.begin(), set.end(), &arena);
+  combinations::pmr::Generator<int, Comb> generator(arenaSet, &arena);
+  generator.generate(m);
+  auto &combs = generator.getCombinations();
+  uint64_t state = 0x9e3779b97f4a7c15;
+  measure(result, args, [&]() {
+    for (size_t i = 0; i < combs.size(); ++i) {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      const Comb &comb = combs[state % combs.size()];
+      sink = sink + comb[0] + comb[comb.size()-1];
+    } // for
+    return combs.size();
+  });
+} // benchRandom
+
+
+//      Function : benchTiles
+//      Abstract : Sum the dot products of the 64-byte feature vectors
+//      of all M-element index combinations, traversed in tiles of
+//      block indices. A block of n is plain lexicographic order.
+template <size_t M>
+void
+benchTiles(BenchResult &result, size_t n, uint32_t block,
+           bool parallel, const BenchArgs &args)
+{
+  constexpr size_t DIM = 8;
+  std::vector<double> features(n * DIM);
+  std::iota(features.begin(), features.end(), 0.0);
+  auto dot = [&](auto... idx) {
+    double sum = 0.0;
+    for (size_t d = 0; d < DIM; ++d) {
+      sum += (features[idx * DIM + d] * ...);
+    } // for
+    return sum;
+  };
+  unsigned threads = args.threads ? args.threads
+                                  : std::thread::hardware_concurrency();
+  // One cache line per worker to avoid false sharing.
+  std::vector<std::array<double, DIM>> partial(std::max(1u, threads));
+  measure(result, args, [&]() {
+    double total = 0.0;
+    if (parallel) {
+      combinations::tiles::parallelForEachTile<M>(
+        n, block, [&](const auto &tile, unsigned w) {
+          double sum = 0.0;
+          tile.forEach([&](auto... idx) { sum += dot(idx...); });
+          partial[w][0] += sum;
+        }, threads);
+      for (auto &line : partial) {
+        total += line[0];
+        line[0] = 0.0;
+      } // for each worker
+    } else {
+      combinations::tiles::forEachTile<M>(n, block, [&](const auto &tile) {
+        tile.forEach([&](auto... idx) { total += dot(idx...); });
+      });
+    } // if
+    sink = sink + size_t(total);
+    return combinations::binomial(n, M);
+  });
+} // benchTiles
+
+
+//      Function : benchFixed
+//      Abstract : Run the FixedEnumerator for M over the set.
+template <size_t M>
+void
+benchFixed(BenchResult &result,
+           const std::vector<int> &set,
+           const BenchArgs &args)
+{
+  measure(result, args, [&]() {
+    combinations::FixedEnumerator<int, M> enumerator(set);
+    size_t cnt = 0;
+    for (bool more = enumerator.first(); more; more = enumerator.next()) {
+      sink = sink + enumerator.indices()[0];
+      ++cnt;
+    } // for
+    return cnt;
+  });
+} // benchFixed
+
+
+//      Function : benchFixed
+//      Abstract : Dispatch to the FixedEnumerator for m = 1..8.
+void
+benchFixed(BenchResult &result,
+           const std::vector<int> &set,
+           size_t m,
+           const BenchArgs &args)
+{
+  switch (m) {
+  case 1: benchFixed<1>(result, set, args); break;
+  case 2: benchFixed<2>(result, set, args); break;
+  case 3: benchFixed<3>(result, set, args); break;
+  case 4: benchFixed<4>(result, set, args); break;
+  case 5: benchFixed<5>(result, set, args); break;
+  case 6: benchFixed<6>(result, set, args); break;
+  case 7: benchFixed<7>(result, set, args); break;
+  case 8: benchFixed<8>(result, set, args); break;
+  default:
+    throw std::invalid_argument("Fixed enumerator supports m <= 8.");
+  } // switch
+} // benchFixed
+
+
+//      Function : benchEngine
+//      Abstract : Run one engine over the set for subsets of size m.
+//      Kernel engines are named kernel:variant.
+void
+benchEngine(BenchResult &result,
+            const std::vector<int> &set,
+            size_t m,
+            const BenchArgs &args)
+{
+  size_t n = set.size();
+  if (result.engine == "enumerator") {
+    measure(result, args, [&]() {
+      combinations::Enumerator<int> enumerator(set);
+      size_t cnt = 0;
+      for (auto comb = enumerator.first(m);
+           comb.size();
+           comb = enumerator.next()) {
+        sink = sink + comb[0];
+        ++cnt;
+      } // for
+      return cnt;
+    });
+  } else if (result.engine == "next") {
+    std::vector<uint32_t> comb(m);
+    measure(result, args, [&]() {
+      std::iota(comb.begin(), comb.end(), 0u);
+      size_t cnt = 0;
+      do {
+        sink = sink + comb[0];
+        ++cnt;
+      } while (combinations::next_combination(comb.begin(), comb.end(),
+                                              uint32_t(n)));
+      return cnt;
+    });
+  } else if (result.engine == "best-first") {
+    // The lightest 64K combinations, as a ranking job would take.
+    std::vector<double> weights(n);
+    for (size_t i = 0; i < n; ++i) {
+      weights[i] = double((i * 2654435761u) % 1000);
+    } // for
+    measure(result, args, [&]() {
+      combinations::BestFirstEnumerator<int> best(set, weights);
+      size_t cnt = 0;
+      for (auto comb = best.first(m);
+           comb.size() && cnt < (1 << 16);
+           comb = best.next()) {
+        sink = sink + comb[0];
+        ++cnt;
+      } // for
+      return cnt;
+    });
+  } else if (result.engine == "fixed") {
+    benchFixed(result, set, m, args);
+  } else if (result.engine == "lexor") {
+    measure(result, args, [&]() {
+      combinations::Lexor<int> lexor(set, m);
+      size_t cnt = combinations::Counter().count(n, m);
+      for (size_t i = 0; i < cnt; ++i) {
+        sink = sink + lexor.get(i)[0];
+      } // for
+      return cnt;
+    });
+  } else if (result.engine == "lexor-sbo") {
+    measure(result, args, [&]() {
+      combinations::Lexor<int, combinations::Combination<int>> lexor(set, m);
+      size_t cnt = combinations::Counter().count(n, m);
+      for (size_t i = 0; i < cnt; ++i) {
+        sink = sink + lexor.get(i)[0];
+      } // for
+      return cnt;
+    });
+  } else if (result.engine == "generator-sbo") {
+    measure(result, args, [&]() {
+      combinations::Generator<int, combinations::Combination<int>>
+        generator(set);
+      generator.generate(m);
+      sink = sink + generator.size();
+      return generator.size();
+    });
+  } else if (result.engine == "generator") {
+    measure(result, args, [&]() {
+      combinations::Generator<int> generator(set);
+      generator.generate(m);
+      sink = sink + generator.size();
+      return generator.size();
+    });
+  } else if (result.engine == "generator-arena") {
+    std::pmr::vector<int> arenaSet(set.begin(), set.end());
+    measure(result, args, [&]() {
+      std::pmr::monotonic_buffer_resource arena;
+      combinations::pmr::Generator<int> generator(arenaSet, &arena);
+      generator.generate(m);
+      sink = sink + generator.size();
+      return generator.size();
+    });
+  } else if (result.engine == "generator-trie") {
+    measure(result, args, [&]() {
+      combinations::TrieGenerator<int> trie(set);
+      trie.generate(m);
+      sink = sink + trie.bytes();
+      return trie.size();
+    });
+  } else if (result.engine == "trie-get") {
+    // Random access by rank in a pseudo-random order.
+    combinations::TrieGenerator<int> trie(set);
+    trie.generate(m);
+    std::vector<uint32_t> idx(m);
+    measure(result, args, [&]() {
+      size_t size = trie.size();
+      for (size_t i = 0, r = 0; i < size; ++i) {
+        r = (r + 2654435761u) % size;
+        trie.indices(r, idx.data());
+        sink = sink + idx[0];
+      } // for
+      return size;
+    });
+  } else if (result.engine == "random") {
+    benchRandom(result, set, m, args, std::pmr::new_delete_resource());
+  } else if (result.engine == "random-huge") {
+    combinations::huge::Resource huge;
+    benchRandom(result, set, m, args, &huge);
+  } else if (result.engine.starts_with("tiles")) {
+    uint32_t block = result.engine == "tiles-lex" ? n : args.block;
+    bool parallel = result.engine == "tiles-parallel";
+    if (m == 2) {
+      benchTiles<2>(result, n, block, parallel, args);
+    } else {
+      benchTiles<3>(result, n, block, parallel, args);
+    } // if
+  } else if (result.engine == "subset-sum") {
+    // One exact search; the rate is per combination of the full set
+    // that a brute force search would have visited.
+    std::vector<int64_t> weights(n);
+    for (size_t i = 0; i < n; ++i) {
+      weights[i] = int64_t((i * 2654435761u) % 1000);
+    } // for
+    combinations::SubsetSum<int64_t> search(weights);
+    measure(result, args, [&]() {
+      size_t found = search.find(m, int64_t(500 * m), 0,
+                                 [](const auto &match) {
+                                   sink = sink + match.leftRank; });
+      sink = sink + found;
+      return combinations::binomial(n, m);
+    });
+  } else if (result.engine == "swaps") {
+    // Rank every swap neighbour of evenly spread indices; the rate is
+    // per neighbour.
+    std::vector<uint32_t> idx(m);
+    for (size_t i = 0; i < m; ++i) {
+      idx[i] = uint32_t(i * n / m);
+    } // for
+    combinations::SwapNeighborhood hood(n, m);
+    measure(result, args, [&]() {
+      size_t cnt = 0;
+      hood.forEach(idx.data(), [&](const combinations::Swap &swap) {
+        sink = sink + swap.rank;
+        ++cnt;
+      });
+      return cnt;
+    });
+  } else if (result.engine == "aggregates") {
+    // Sum of products in O(n*m); the rate is per combination that
+    // enumeration would have visited.
+    std::vector<double> weights(n);
+    for (size_t i = 0; i < n; ++i) {
+      weights[i] = double((i * 2654435761u) % 1000) / 1000.0;
+    } // for
+    combinations::Aggregates<double> aggregates(weights);
+    measure(result, args, [&]() {
+      sink = sink + size_t(aggregates.sumOfProducts(m) > 0.0);
+      return combinations::binomial(n, m);
+    });
+  } else if (result.engine == "constrained") {
+    // Visit the subsets of at most average weight by stepping through
+    // the constrained space; the rate is per valid subset.
+    std::vector<int64_t> weights(n);
+    for (size_t i = 0; i < n; ++i) {
+      weights[i] = int64_t((i * 2654435761u) % 100);
+    } // for
+    combinations::constraints::AtMost atMost{int64_t(50 * m)};
+    combinations::ConstrainedCounter counter(weights, m, atMost);
+    measure(result, args, [&]() {
+      auto idx = counter.unrank(0);
+      size_t cnt = 1;
+      while (counter.next(idx)) {
+        sink = sink + idx[0];
+        ++cnt;
+      } // while
+      return cnt;
+    });
+  } else if (result.engine == "counter") {
+    measure(result, args, [&]() {
+      sink = sink + combinations::Counter().count(n, m);
+      return size_t(1);
+    });
+  } else if (size_t colon = result.engine.find(':');
+             colon != std::string::npos) {
+    std::string variant = result.engine.substr(colon + 1);
+    for (auto kernels : combinations::kernels::variants()) {
+      if (variant == kernels->name) {
+        benchKernel(result, *kernels, result.engine.substr(0, colon),
+                    n, m, args);
+        return;
+      } // if
+    } // for each variant
+    throw std::invalid_argument("Unsupported variant: " + result.engine);
+  } else {
+    throw std::invalid_argument("Unknown engine: " + result.engine);
+  } // if
+} // benchEngine
+
+
+//      Function : expandEngines
+//      Abstract : Replace "kernels" by every kernel of every variant
+//      the host supports.
+std::vector<std::string>
+expandEngines(const std::vector<std::string> &engines)
+{
+  std::vector<std::string> result;
+  for (const auto &engine : engines) {
+    if (engine != "kernels") {
+      result.push_back(engine);
+      continue;
+    } // if
+    for (const char *kernel : {"successor", "unrank", "mask", "batch",
+                               "masked", "frommasks"}) {
+      for (auto kernels : combinations::kernels::variants()) {
+        result.push_back(std::string(kernel) + ":" + kernels->name);
+      } // for each variant
+    } // for each kernel
+  } // for each engine
+  return result;
+} // expandEngines
+
+
+//      Function : writeJson
+//      Abstract : Emit the results as JSON for regression tracking.
+void
+writeJson(std::ostream &out, const std::vector<BenchResult> &results)
+{
+  out << "{\n  \"context\": {\"compiler\": \"" << __VERSION__ << "\""
+#ifdef NDEBUG
+      << ", \"ndebug\": true"
+#else
+      << ", \"ndebug\": false"
+#endif
+      << "},\n  \"benchmarks\": [";
+  const char *sep = "\n";
+  for (const auto &r : results) {
+    out << sep << "    {\"engine\": \"" << r.engine << "\""
+        << ", \"n\": " << r.n
+        << ", \"m\": " << r.m
+        << ", \"combinations\": " << r.combinations
+        << ", \"iterations\": " << r.iterations
+        << ", \"ns_per_comb\": " << r.nsPerComb()
+        << ", \"rel_stddev\": " << r.relStddev
+        << ", \"combs_per_sec\": " << r.combsPerSec()
+        << ", \"allocs_per_comb\": ";
+    if (alloc::enabled) {
+      out << r.allocsPerComb()
+          << ", \"bytes_per_comb\": " << r.bytesPerComb()
+          << ", \"peak_bytes\": " << r.peakBytes;
+    } else {
+      out << "null, \"bytes_per_comb\": null, \"peak_bytes\": null";
+    } // if
+    for (int ev = 0; ev < perf::Counters::NUM_EVENTS; ++ev) {
+      auto event = perf::Counters::Event(ev);
+      out << ", \"" << perf::Counters::name(event) << "_per_comb\": ";
+      if (r.perComb(event) < 0) {
+        out << "null";
+      } else {
+        out << r.perComb(event);
+      } // if
+    } // for each event
+    out << "}";
+    sep = ",\n";
+  } // for each result
+  out << "\n  ]\n}\n";
+} // writeJson
+
+
+//      Function : printResult
+//      Abstract : Print a one-line summary of a result.
+void
+printResult(const BenchResult &r)
+{
+  std::cout << std::left << std::setw(18) << r.engine << std::right
+            << " n=" << std::setw(3) << r.n
+            << " m=" << std::setw(2) << r.m
+            << std::setw(12) << std::setprecision(4) << r.nsPerComb()
+            << " ns/comb"
+            << std::setw(12) << r.combsPerSec() << " comb/s";
+  if (alloc::enabled) {
+    std::cout << std::setw(10) << r.allocsPerComb() << " alloc/comb"
+              << std::setw(12) << r.peakBytes << " peak bytes";
+  } // if
+  for (int ev = 0; ev < perf::Counters::NUM_EVENTS; ++ev) {
+    auto event = perf::Counters::Event(ev);
+    if (hwCounters().available(event)) {
+      std::cout << std::setw(10) << r.perComb(event) << " "
+                << perf::Counters::name(event);
+    } // if
+  } // for each event
+  std::cout << std::endl;
+} // printResult
+
+
+//      Function : jsonField
+//      Abstract : Extract the value of a key from a one-line JSON
+//      object as written by writeJson.
+std::string
+jsonField(const std::string &line, const std::string &key)
+{
+  std::string tag = "\"" + key + "\": ";
+  size_t pos = line.find(tag);
+  if (pos == std::string::npos) {
+    return "";
+  } // if
+  pos += tag.size();
+  size_t end = line.find_first_of(",}", pos);
+  std::string value = line.substr(pos, end - pos);
+  if (value.size() >= 2 && value.front() == '"') {
+    value = value.substr(1, value.size() - 2);
+  } // if
+  return value;
+} // jsonField
+
+
+// Baseline results keyed by "engine/n/m".
+using Baseline = std::map<std::string, BenchResult>;
+
+
+//      Function : resultKey
+//      Abstract : Key identifying an (engine, n, m) point.
+std::string
+resultKey(const BenchResult &r)
+{
+  return r.engine + "/" + std::to_string(r.n) + "/" + std::to_string(r.m);
+} // resultKey
+
+
+//      Function : loadBaseline
+//      Abstract : Read the timings of a JSON file written by a
+//      previous run.
+Baseline
+loadBaseline(const std::string &file)
+{
+  std::ifstream in(file);
+  if (! in) {
+    throw std::runtime_error("Cannot read baseline " + file);
+  } // if
+  Baseline baseline;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (jsonField(line, "engine").empty()) {
+      continue;
+    } // if
+    BenchResult r;
+    r.engine = jsonField(line, "engine");
+    r.n = std::stoul(jsonField(line, "n"));
+    r.m = std::stoul(jsonField(line, "m"));
+    r.nsMedian = std::stod(jsonField(line, "ns_per_comb"));
+    std::string dev = jsonField(line, "rel_stddev");
+    r.relStddev = dev.empty() ? 0.0 : std::stod(dev);
+    baseline[resultKey(r)] = r;
+  } // while
+  return baseline;
+} // loadBaseline
+
+
+//      Function : compare
+//      Abstract : Flag throughput regressions against the baseline.
+//      A point regresses when its slowdown exceeds both the threshold
+//      and noiseFactor combined standard deviations of the two runs.
+//      Returns the number of regressions.
+size_t
+compare(const std::vector<BenchResult> &results,
+        const Baseline &baseline,
+        const BenchArgs &args)
+{
+  size_t regressions = 0;
+  size_t compared = 0;
+  double logRatio = 0.0;
+  for (const auto &r : results) {
+    auto it = baseline.find(resultKey(r));
+    if (it == baseline.end()) {
+      std::cout << std::setw(24) << resultKey(r) << "  no baseline"
+                << std::endl;
+      continue;
+    } // if
+    const BenchResult &b = it->second;
+    double noise = args.noiseFactor *
+      std::sqrt(r.relStddev * r.relStddev + b.relStddev * b.relStddev);
+    double tolerance = std::max(args.threshold, noise);
+    double slowdown = r.nsPerComb() / b.nsPerComb() - 1.0;
+    bool regressed = slowdown > tolerance;
+    regressions += regressed;
+    logRatio += std::log(r.nsPerComb() / b.nsPerComb());
+    ++compared;
+    std::cout << std::setw(24) << resultKey(r)
+              << std::setw(10) << std::setprecision(3) << std::showpos
+              << 100 * slowdown << std::noshowpos
+              << "% time change (tolerance " << 100 * tolerance << "%)"
+              << (regressed ? "  REGRESSION" : "") << std::endl;
+  } // for each result
+  if (compared) {
+    std::cout << "Geometric mean speedup: "
+              << std::exp(-logRatio / compared) << std::endl;
+  } // if
+  return regressions;
+} // compare
+
+
+//      Function : main
+//      Abstract : Benchmark driver.
+int
+main(int argc, char *argv[])
+{
+  auto args = argparse::parse<BenchArgs>(argc, argv);
+  args.print();
+  if (! hwCounters().anyAvailable()) {
+    std::cout << "Hardware counters unavailable; "
+              << "reporting throughput only." << std::endl;
+  } // if
+
+  std::vector<BenchResult> results;
+  Baseline baseline;
+  try {
+    if (! args.baseline.empty()) {
+      baseline = loadBaseline(args.baseline);
+    } // if
+    for (const auto &engine : expandEngines(args.engines)) {
+      for (size_t n : args.nSizes) {
+        std::vector<int> set(n);
+        std::iota(set.begin(), set.end(), 0);
+        for (size_t m : args.mSizes) {
+          // Meet in the middle only tabulates the halves, swaps
+          // only visit one neighbourhood, aggregates are O(n*m) and
+          // frommasks decodes at most 64K masks. Engines on 64-bit
+          // masks need n <= 64.
+          size_t work = engine == "subset-sum" ?
+            combinations::Counter().count(n - n/2, (m+1)/2) :
+            engine == "swaps" ? m * (n - m) :
+            engine == "aggregates" ? n * m :
+            engine.starts_with("frommasks") ? size_t(1) << 16 :
+            combinations::Counter().count(n, m);
+          if (m == 0 || m > n || work > args.limit ||
+              (n > 64 && engine.find("mask") != std::string::npos) ||
+              (m > 8 && engine == "fixed") ||
+              (m == n && engine == "swaps") ||
+              (m != 2 && m != 3 && engine.starts_with("tiles"))) {
+            continue;
+          } // if
+          BenchResult result;
+          result.engine = engine;
+          result.n = n;
+          result.m = m;
+          benchEngine(result, set, m, args);
+          printResult(result);
+          results.push_back(result);
+        } // for each m
+      } // for each n
+    } // for each engine
+  } catch (std::exception &err) {
+    std::cout << err.what() << std::endl;
+    return 1;
+  } // try/catch
+
+  std::ofstream out(args.json);
+  writeJson(out, results);
+  std::cout << "Wrote " << results.size() << " results to "
+            << args.json << std::endl;
+
+  if (! args.baseline.empty()) {
+    std::cout << "Comparing against " << args.baseline << std::endl;
+    size_t regressions = compare(results, baseline, args);
+    std::cout << regressions << " regression(s)." << std::endl;
+    return regressions ? 2 : 0;
+  } // if
+
+  return 0;
+} // main
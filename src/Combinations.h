@@ -7,28 +7,59 @@
 #ifndef COMBINATIONS_H
 #define COMBINATIONS_H
 
+#include <algorithm>
+#include <array>
 #include <cassert>
+#include <compare>
 #include <concepts>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <numeric>
 #include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "TraceScope.h"
+
 namespace combinations {
 
-//      Class    : Counter
-//      Abstract : Class for counting all m-element sets of
-class Counter {
+// Rebind an allocator to another value type.
+template <class Alloc, class U>
+using Rebind = typename std::allocator_traits<Alloc>::template rebind_alloc<U>;
+
+
+//      Class    : BasicCounter
+//      Abstract : Class for counting all m-element sets of an
+//      n-element set. The memo table is allocated through Alloc.
+//      Counter uses the default allocator.
+template <class Alloc = std::allocator<size_t>>
+class BasicCounter {
 public:
-  Counter() :
-    _counts(16) {}; // CTOR
-  ~Counter() = default; // DTOR
+  using allocator_type = Alloc;
+
+  BasicCounter(const Alloc &alloc = Alloc()) :
+    _counts(16, CombPairHash(), std::equal_to<CombPair>(),
+            MapAlloc(alloc)) {}; // CTOR
+  ~BasicCounter() = default; // DTOR
 
   size_t count(size_t n, size_t m);
 
-  Counter(const Counter &) = delete; // Copy CTOR
-  Counter &operator=(const Counter &) = delete; // Copy assignment
-  Counter(Counter &&) = delete; // Move CTOR
-  Counter &operator=(Counter &&) = delete; // Move assignment
+  BasicCounter(const BasicCounter &) = delete; // Copy CTOR
+  BasicCounter &operator=(const BasicCounter &) = delete; // Copy assignment
+  BasicCounter(BasicCounter &&) = delete; // Move CTOR
+  BasicCounter &operator=(BasicCounter &&) = delete; // Move assignment
 private:
   // Storing and hashing an (n,m) pair.
   using CombPair = std::pair<size_t, size_t>;
@@ -36,11 +67,15 @@ private:
     size_t operator()(const CombPair &pair) const {
       return pair.first ^ (pair.second<<1); };
   }; // CombPairHash
+  using MapAlloc = Rebind<Alloc, std::pair<const CombPair, size_t>>;
 
   size_t countRec(size_t n, size_t m);
 
-  std::unordered_map<CombPair, size_t, CombPairHash> _counts;
-}; // Counter
+  std::unordered_map<CombPair, size_t, CombPairHash,
+                     std::equal_to<CombPair>, MapAlloc> _counts;
+}; // BasicCounter
+
+using Counter = BasicCounter<>;
 
 
 //      Class    : Enumerator
@@ -48,21 +83,25 @@ private:
 //      of an n-element set one at a time. This would normally be used
 //      in a loop when random access to all of the combinations is
 //      unnecessary. The original set is specified as a standard
-//      vector of type T. Type T must be copy-constructible.
-template <class T = int>
+//      vector of type T. Type T must be copy-constructible. The
+//      enumeration state is allocated through Alloc.
+template <class T = int, class Alloc = std::allocator<T>>
 class Enumerator {
 #if __cplusplus >= 202002L
   static_assert(std::copy_constructible<T>);
 #endif
 public:
-  using Set = std::vector<T>;
+  using Set = std::vector<T, Alloc>;
+  using allocator_type = Alloc;
 
-  Enumerator(const Set &set) :
-    _set(set), _m(0) {}; // CTOR
+  Enumerator(const Set &set, const Alloc &alloc = Alloc()) :
+    _set(set), _m(0), _curSet(alloc), _idx(alloc) {}; // CTOR
   ~Enumerator() = default; // DTOR
 
   Set first(size_t m);
   Set next();
+  Set skip(size_t k); // Skip the rest sharing the first k indices.
+  const auto &indices() const { return _idx; };
 
   Enumerator(const Enumerator &) =
     delete; // Copy CTOR
@@ -74,14 +113,250 @@ public:
     delete; // Move assignment
 
  private:
+  Set advance(size_t k);
+
   const Set &_set;
   size_t _m;
   Set _curSet;
-  std::vector<size_t> _idxStack;
-  std::vector<int> _stateStack;
+  // Indices of the current combination; empty after the last one.
+  std::vector<size_t, Rebind<Alloc, size_t>> _idx;
 }; // Enumerator
 
 
+//      Class    : BestFirstEnumerator
+//      Abstract : Template class for enumerating the m-element subsets
+//      of an n-element set in nondecreasing order of the sum of their
+//      element weights. Elements are ranked by weight, and subsets of
+//      ranks form a tree rooted at {0, ..., m-1}. A node has an active
+//      position j. Its children increment rank j, or increment rank
+//      j-1 and make j-1 active. Every subset is reached exactly once,
+//      and no child is lighter than its parent, so taking nodes from a
+//      priority queue yields the subsets in order. Each output adds
+//      at most two nodes, so memory grows with the number of outputs
+//      rather than with C(n, m). Combinations are returned in the
+//      order of the set. Equal sums are ordered by their weight ranks.
+template <class T = int, class W = double, class Alloc = std::allocator<T>>
+class BestFirstEnumerator {
+#if __cplusplus >= 202002L
+  static_assert(std::copy_constructible<T>);
+#endif
+public:
+  using Set = std::vector<T, Alloc>;
+  using Weights = std::vector<W, Rebind<Alloc, W>>;
+  using allocator_type = Alloc;
+
+  BestFirstEnumerator(const Set &set, const Weights &weights,
+                      const Alloc &alloc = Alloc()); // CTOR
+  ~BestFirstEnumerator() = default; // DTOR
+
+  Set first(size_t m);
+  Set next();
+  W weight() const { return _weight; }; // Of the current combination.
+  size_t queued() const { return _heap.size(); };
+
+  BestFirstEnumerator(const BestFirstEnumerator &) =
+    delete; // Copy CTOR
+  BestFirstEnumerator &operator=(const BestFirstEnumerator &) =
+    delete; // Copy assignment
+  BestFirstEnumerator(BestFirstEnumerator &&) =
+    delete; // Move CTOR
+  BestFirstEnumerator &operator=(BestFirstEnumerator &&) =
+    delete; // Move assignment
+
+ private:
+  // A queued subset: its weight, where its m ranks start in _ranks
+  // and its active position.
+  struct Node {
+    W weight;
+    size_t offset;
+    size_t active;
+  }; // Node
+
+  bool heavier(const Node &a, const Node &b) const;
+  void push(const Node &parent, size_t pos, size_t active);
+
+  const Set &_set;
+  const Weights &_weights;
+  size_t _m;
+  W _weight;
+  Set _curSet;
+  // Element indices by ascending weight.
+  std::vector<size_t, Rebind<Alloc, size_t>> _order;
+  // Ranks of all queued and produced subsets, m per subset.
+  std::vector<size_t, Rebind<Alloc, size_t>> _ranks;
+  std::vector<Node, Rebind<Alloc, Node>> _heap;
+  std::vector<size_t, Rebind<Alloc, size_t>> _idx;
+}; // BestFirstEnumerator
+
+
+//      Type     : FixedCombination
+//      Abstract : Indices of a combination with m fixed at compile
+//      time, in ascending order.
+template <size_t M>
+using FixedCombination = std::array<uint32_t, M>;
+
+
+// Functions usable in constant expressions, e.g. to build lookup
+// tables at compile time that follow the library's lexicographical
+// order. Binomial throws std::overflow_error (a compile error in a
+// constant expression) if the result does not fit in size_t.
+constexpr size_t binomial(size_t n, size_t m);
+template <size_t M>
+constexpr bool successor(FixedCombination<M> &comb, size_t n);
+template <size_t M>
+constexpr FixedCombination<M> unrank(size_t i, size_t n);
+template <size_t M>
+constexpr size_t rank(const FixedCombination<M> &comb, size_t n);
+template <size_t N, size_t M>
+constexpr std::array<FixedCombination<M>, binomial(N, M)> combinationTable();
+
+// In-place lexicographic successor and predecessor of an ascending
+// range of indices into {0,...,n-1}, in the manner of
+// std::next_permutation: at the end they wrap around to the first
+// (last) combination and return false.
+template <class BidirIt>
+constexpr bool next_combination(
+  BidirIt first, BidirIt last,
+  typename std::iterator_traits<BidirIt>::value_type n);
+template <class BidirIt>
+constexpr bool prev_combination(
+  BidirIt first, BidirIt last,
+  typename std::iterator_traits<BidirIt>::value_type n);
+
+
+//      Class    : FixedEnumerator
+//      Abstract : Template class for enumerating the M-element subsets
+//      of an n-element set in lexicographical order when M is known at
+//      compile time. The state is a FixedCombination, which the
+//      compiler can keep in registers, and the successor logic is
+//      fully unrolled. Unlike Enumerator, first() and next() return
+//      false at the end of the enumeration and the current
+//      combination is read with indices() or get(). The original set
+//      is specified as a standard vector of type T. Type T must be
+//      copy-constructible.
+template <class T, size_t M, class Alloc = std::allocator<T>>
+class FixedEnumerator {
+#if __cplusplus >= 202002L
+  static_assert(std::copy_constructible<T>);
+#endif
+  static_assert(M > 0);
+public:
+  using Set = std::vector<T, Alloc>;
+  using Elements = std::array<T, M>;
+
+  constexpr FixedEnumerator(const Set &set) :
+    _set(set), _n(set.size()), _idx{} {}; // CTOR
+  ~FixedEnumerator() = default; // DTOR
+
+  constexpr bool first();
+  constexpr bool next();
+  constexpr const FixedCombination<M> &indices() const { return _idx; };
+  constexpr Elements get() const;
+
+  FixedEnumerator(const FixedEnumerator &) =
+    delete; // Copy CTOR
+  FixedEnumerator &operator=(const FixedEnumerator &) =
+    delete; // Copy assignment
+  FixedEnumerator(FixedEnumerator &&) =
+    delete; // Move CTOR
+  FixedEnumerator &operator=(FixedEnumerator &&) =
+    delete; // Move assignment
+
+ private:
+  const Set &_set;
+  uint32_t _n;
+  FixedCombination<M> _idx;
+}; // FixedEnumerator
+
+
+//      Class    : Combination
+//      Abstract : Owning combination value type with inline storage
+//      for up to N elements, spilling to the heap beyond that. It
+//      provides the subset of the std::vector interface used by the
+//      library, so it can be used in place of std::vector<T> as the
+//      combination type of Lexor and Generator. Moves of inline
+//      combinations move the elements; moves of spilled ones steal
+//      the heap buffer when the allocators compare equal. Spilled
+//      elements are allocated through Alloc.
+template <class T, size_t N = 8, class Alloc = std::allocator<T>>
+class Combination {
+  static_assert(N > 0);
+public:
+  using value_type = T;
+  using size_type = size_t;
+  using iterator = T *;
+  using const_iterator = const T *;
+  using allocator_type = Alloc;
+
+  Combination() noexcept :
+    Combination(Alloc()) {}; // CTOR
+  explicit Combination(const Alloc &alloc) noexcept :
+    _alloc(alloc), _data(inlineData()), _size(0), _capacity(N) {}; // CTOR
+  Combination(std::initializer_list<T> init,
+              const Alloc &alloc = Alloc()); // CTOR
+  ~Combination(); // DTOR
+
+  Combination(const Combination &other) :
+    Combination(other, AllocTraits::
+                select_on_container_copy_construction(
+                  other._alloc)) {}; // Copy CTOR
+  Combination(const Combination &other, const Alloc &alloc); // Copy CTOR
+  Combination &operator=(const Combination &other); // Copy assignment
+  Combination(Combination &&other)
+    noexcept(std::is_nothrow_move_constructible_v<T>) :
+    Combination(std::move(other), other._alloc) {}; // Move CTOR
+  Combination(Combination &&other, const Alloc &alloc)
+    noexcept(NOTHROW_TAKE); // Move CTOR
+  Combination &operator=(Combination &&other)
+    noexcept(NOTHROW_TAKE); // Move assignment
+
+  Alloc get_allocator() const { return _alloc; };
+  size_t size() const { return _size; };
+  bool empty() const { return _size == 0; };
+  size_t capacity() const { return _capacity; };
+  bool isInline() const { return _data == inlineData(); };
+  void reserve(size_t capacity);
+  void clear();
+  void push_back(const T &elem);
+  void pop_back() { _data[--_size].~T(); };
+
+  T &operator[](size_t i) { return _data[i]; };
+  const T &operator[](size_t i) const { return _data[i]; };
+  T *data() { return _data; };
+  const T *data() const { return _data; };
+  T *begin() { return _data; };
+  T *end() { return _data + _size; };
+  const T *begin() const { return _data; };
+  const T *end() const { return _data + _size; };
+
+  bool operator==(const Combination &other) const {
+    return std::equal(begin(), end(), other.begin(), other.end()); };
+  auto operator<=>(const Combination &other) const {
+    return std::lexicographical_compare_three_way(begin(), end(),
+                                                  other.begin(),
+                                                  other.end()); };
+private:
+  using AllocTraits = std::allocator_traits<Alloc>;
+  // take() allocates when the allocators differ, and the allocator
+  // isn't propagated, so only always equal allocators never throw.
+  static constexpr bool NOTHROW_TAKE =
+    std::is_nothrow_move_constructible_v<T> &&
+    AllocTraits::is_always_equal::value;
+
+  T *inlineData() { return reinterpret_cast<T *>(_buffer); };
+  const T *inlineData() const {
+    return reinterpret_cast<const T *>(_buffer); };
+  void release();
+  void take(Combination &&other);
+
+  [[no_unique_address]] Alloc _alloc;
+  alignas(T) unsigned char _buffer[N * sizeof(T)];
+  T *_data;
+  size_t _size;
+  size_t _capacity;
+}; // Combination
+
+
 //      Class    : Lexor
 //      Abstract : Template class for providing random access to
 //      m-element subsets of n-element sets. The original set is
@@ -89,21 +364,29 @@ public:
 //      copy-constructible. Random access is by the ith m-element
 //      subset based on lexicographical ordering. The first subset is
 //      {0, 1, ..., m-1}. The last subset is {n-m, n-m+1, ..., n-1}.
-template <class T = int>
+//      Combinations are returned as type C, which may be a
+//      Combination to avoid allocating. The set, the combinations and
+//      the count table use the allocator type of C.
+template <class T = int, class C = std::vector<T>,
+          class Alloc = typename C::allocator_type>
 class Lexor {
 #if __cplusplus >= 202002L
   static_assert(std::copy_constructible<T>);
 #endif
 public:
-  using Set = std::vector<T>;
+  using Set = std::vector<T, Alloc>;
+  using allocator_type = Alloc;
 
-  Lexor(const Set &set, const size_t m) :
-    _set(set), _n(set.size()), _m(m) {}; // CTOR
+  Lexor(const Set &set, const size_t m, const Alloc &alloc = Alloc()) :
+    _set(set), _n(set.size()), _m(m), _alloc(alloc),
+    _counter(alloc) {}; // CTOR
   ~Lexor() = default; // DTOR
 
   void setM(size_t m);
-  std::vector<T> get(size_t i, size_t m); // Sets m as side effect.
-  std::vector<T> get(size_t i);
+  C get(size_t i, size_t m); // Sets m as side effect.
+  C get(size_t i);
+  template <class Indices>
+  std::pair<size_t, size_t> prefixRange(const Indices &prefix);
 
   Lexor(const Lexor &) = delete; // Copy CTOR
   Lexor &operator=(const Lexor &) = delete; // Copy assignment
@@ -114,12 +397,14 @@ private:
            size_t m,
            size_t i,
            size_t nel,
-           std::vector<T> &r);
+           C &r);
+  void getSmall(size_t i, size_t count, C &r);
 
   const Set &_set;
   size_t _n;
   size_t _m;
-  Counter _counter;
+  [[no_unique_address]] Alloc _alloc;
+  BasicCounter<Alloc> _counter;
 }; // Lexor
 
 
@@ -129,21 +414,28 @@ private:
 //      standard vector of type T. The result is a vector of vectors
 //      of type T. This is memory intensive, but allows random access
 //      to the combinations if needed. Type T must be copy-constructible.
-template <class T = int>
+//      Combinations are stored as type C, which may be a Combination
+//      to store small combinations without separate allocations. All
+//      storage uses the allocator type of C; with an arena allocator
+//      the combinations are freed wholesale by releasing the arena.
+template <class T = int, class C = std::vector<T>,
+          class Alloc = typename C::allocator_type>
 class Generator {
 #if __cplusplus >= 202002L
   static_assert(std::copy_constructible<T>);
 #endif
 public:
-  using Set = std::vector<T>;
+  using Set = std::vector<T, Alloc>;
+  using Combinations = std::vector<C, Rebind<Alloc, C>>;
+  using allocator_type = Alloc;
 
-  Generator(const Set &set) :
-    _set(set) {}; // CTOR
+  Generator(const Set &set, const Alloc &alloc = Alloc()) :
+    _set(set), _alloc(alloc), _combinations(alloc) {}; // CTOR
   ~Generator() = default; // DTOR
 
   void generate(size_t m);
 
-  std::vector<Set> &getCombinations() { return _combinations; };
+  Combinations &getCombinations() { return _combinations; };
   auto size() { return _combinations.size(); };
   auto begin() { return _combinations.begin(); };
   auto end() { return _combinations.end(); };
@@ -158,24 +450,367 @@ public:
     delete; // Move assignment
 
  private:
-  void generateRec(size_t curIdx, Set &curset);
+  void generateRec(size_t curIdx, C &curset);
 
   const Set &_set;
-  std::vector<Set> _combinations;
+  [[no_unique_address]] Alloc _alloc;
+  Combinations _combinations;
   size_t _m;
 }; // Generator
 
 
+//      Class    : TrieGenerator
+//      Abstract : Generates all m-element subsets like Generator but
+//      stores them as a prefix trie: level d holds one node per
+//      distinct prefix of d+1 indices, with the index of its last
+//      element and of its parent at level d-1. Combinations are the
+//      leaves at level m-1, which are generated in lexicographic
+//      order, so a rank is a leaf and get() follows m-1 parents. A
+//      leaf costs two 32-bit indices however large m is, and prefixes
+//      are stored once. The levels are consecutive in one flat array.
+//      It, the level offsets and all scratch space come from Alloc.
+template <class T = int, class C = std::vector<T>,
+          class Alloc = typename C::allocator_type>
+class TrieGenerator {
+#if __cplusplus >= 202002L
+  static_assert(std::copy_constructible<T>);
+#endif
+public:
+  using Set = std::vector<T, Alloc>;
+  using allocator_type = Alloc;
+
+  TrieGenerator(const Set &set, const Alloc &alloc = Alloc()) :
+    _set(set), _alloc(alloc), _m(0), _size(0),
+    _levels(OffsetAlloc(alloc)), _nodes(NodeAlloc(alloc)) {}; // CTOR
+  ~TrieGenerator() = default; // DTOR
+
+  void generate(size_t m);
+
+  size_t size() const { return _size; };
+  C get(size_t rank) const;
+  void indices(size_t rank, uint32_t *idx) const;
+  template <class Fn>
+  void forEach(Fn fn) const;
+  size_t bytes() const {
+    return _nodes.capacity() * sizeof(Node); };
+
+  TrieGenerator(const TrieGenerator &) =
+    delete; // Copy CTOR
+  TrieGenerator &operator=(const TrieGenerator &) =
+    delete; // Copy assignment
+  TrieGenerator(TrieGenerator &&) =
+    delete; // Move CTOR
+  TrieGenerator &operator=(TrieGenerator &&) =
+    delete; // Move assignment
+
+ private:
+  // A node keeps both indices together, so a step up the trie
+  // touches one cache line.
+  struct Node {
+    uint32_t element;
+    uint32_t parent; // Within the level above.
+  }; // Node
+  using NodeAlloc = Rebind<Alloc, Node>;
+  using OffsetAlloc = Rebind<Alloc, size_t>;
+  using IndexAlloc = Rebind<Alloc, uint32_t>;
+
+  const Set &_set;
+  [[no_unique_address]] Alloc _alloc;
+  size_t _m;
+  size_t _size;
+  // Offset of each level; m+1 entries.
+  std::vector<size_t, OffsetAlloc> _levels;
+  std::vector<Node, NodeAlloc> _nodes;
+}; // TrieGenerator
+
+
+// Variants allocating through a std::pmr::memory_resource, e.g. a
+// monotonic_buffer_resource used as a per-query arena.
+namespace pmr {
+
+template <class T>
+using Allocator = std::pmr::polymorphic_allocator<T>;
+
+using Counter = BasicCounter<Allocator<size_t>>;
+template <class T = int>
+using Enumerator = combinations::Enumerator<T, Allocator<T>>;
+template <class T, size_t N = 8>
+using Combination = combinations::Combination<T, N, Allocator<T>>;
+template <class T = int, class C = std::pmr::vector<T>>
+using Lexor = combinations::Lexor<T, C>;
+template <class T = int, class C = std::pmr::vector<T>>
+using Generator = combinations::Generator<T, C>;
+template <class T = int, class C = std::pmr::vector<T>>
+using TrieGenerator = combinations::TrieGenerator<T, C>;
+
+} // namespace pmr
+
+
 // Function definitions.
 
 
+//      Function : binomial
+//      Abstract : C(n, m) by the multiplicative formula. Each partial
+//      product C(n-m+k, k) is exact; dividing out the gcd first keeps
+//      the intermediate product in range whenever the result is.
+constexpr size_t
+binomial(const size_t n, size_t m)
+{
+  if (m > n) {
+    return 0;
+  } // if
+  m = std::min(m, n-m);
+  size_t result = 1;
+  for (size_t k = 1; k <= m; ++k) {
+    size_t g = std::gcd(result, k);
+    size_t factor = (n-m+k) / (k/g);
+    if (result/g > SIZE_MAX / factor) {
+      throw std::overflow_error("Combination size overflowed.");
+    } // if
+    result = result/g * factor;
+  } // for
+  return result;
+} // binomial
+
+
+namespace detail {
+
+//      Function : advance
+//      Abstract : If index I is not at its maximum, n-M+I, increment
+//      it, let the indices after it follow consecutively and return
+//      true.
+template <size_t M, size_t I>
+constexpr bool
+advance(FixedCombination<M> &comb, const size_t n)
+{
+  if (comb[I] == n - M + I) {
+    return false;
+  } // if
+  uint32_t next = ++comb[I];
+  [&]<size_t... J>(std::index_sequence<J...>) {
+    ((comb[I+1+J] = ++next), ...);
+  }(std::make_index_sequence<M-1-I>());
+  return true;
+} // advance
+
+
+// Lexor unranks by table lookups up to this set size.
+constexpr size_t SMALL_N = 32;
+
+//      Struct   : SmallBinomials
+//      Abstract : Row k holds C(a, k) for a in [0, SMALL_N). The rows
+//      are aligned for vector loads; the largest entry, C(31, 15),
+//      fits in 31 bits, so signed comparisons work.
+struct alignas(64) SmallBinomials {
+  uint32_t rows[SMALL_N + 1][SMALL_N];
+}; // SmallBinomials
+
+
+//      Function : smallBinomials
+//      Abstract : Pascal's triangle for SmallBinomials.
+constexpr SmallBinomials
+smallBinomials()
+{
+  SmallBinomials table{};
+  for (size_t a = 0; a < SMALL_N; ++a) {
+    table.rows[0][a] = 1;
+    for (size_t k = 1; k <= a; ++k) {
+      table.rows[k][a] = table.rows[k-1][a-1] +
+        (k < a ? table.rows[k][a-1] : 0);
+    } // for
+  } // for
+  return table;
+} // smallBinomials
+
+inline constexpr SmallBinomials SMALL_BINOMIALS = smallBinomials();
+
+
+//      Function : countLess
+//      Abstract : Number of entries of a row less than t, by comparing
+//      the whole row with t without branches.
+inline uint32_t
+countLess(const uint32_t (&row)[SMALL_N], const uint32_t t)
+{
+#if defined(__AVX2__)
+  const __m256i tv = _mm256_set1_epi32(int(t));
+  uint32_t cnt = 0;
+  for (size_t a = 0; a < SMALL_N; a += 8) {
+    __m256i less = _mm256_cmpgt_epi32(
+      tv, _mm256_load_si256(reinterpret_cast<const __m256i *>(row + a)));
+    cnt += uint32_t(__builtin_popcount(
+      _mm256_movemask_ps(_mm256_castsi256_ps(less))));
+  } // for
+  return cnt;
+#elif defined(__SSE2__)
+  const __m128i tv = _mm_set1_epi32(int(t));
+  __m128i sum = _mm_setzero_si128();
+  for (size_t a = 0; a < SMALL_N; a += 4) {
+    // Lanes that compare true are -1.
+    sum = _mm_sub_epi32(sum, _mm_cmplt_epi32(
+      _mm_load_si128(reinterpret_cast<const __m128i *>(row + a)), tv));
+  } // for
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+  sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+  return uint32_t(_mm_cvtsi128_si32(sum));
+#else
+  uint32_t cnt = 0;
+  for (size_t a = 0; a < SMALL_N; ++a) {
+    cnt += row[a] < t;
+  } // for
+  return cnt;
+#endif
+} // countLess
+
+} // namespace detail
+
+
+//      Function : successor
+//      Abstract : Advance comb to the next combination of M elements
+//      of {0,...,n-1}. Returns false, leaving comb unchanged, after
+//      the last one. The positions are tried from right to left
+//      through a fold expression, so the loop is unrolled at compile
+//      time.
+template <size_t M>
+constexpr bool
+successor(FixedCombination<M> &comb, const size_t n)
+{
+  return [&]<size_t... K>(std::index_sequence<K...>) {
+    return (detail::advance<M, M-1-K>(comb, n) || ...);
+  }(std::make_index_sequence<M>());
+} // successor
+
+
+//      Function : unrank
+//      Abstract : The i-th M-element subset of {0,...,n-1} in
+//      lexicographical order, as computed by Lexor::get.
+template <size_t M>
+constexpr FixedCombination<M>
+unrank(size_t i, const size_t n)
+{
+  assert(i < binomial(n, M));
+  FixedCombination<M> comb{};
+  size_t el = 0;
+  for (size_t pos = 0; pos < M; ++pos, ++el) {
+    for (size_t cnt = binomial(n-el-1, M-pos-1); i >= cnt;
+         cnt = binomial(n-el-1, M-pos-1)) {
+      i -= cnt;
+      ++el;
+    } // for
+    comb[pos] = el;
+  } // for
+  return comb;
+} // unrank
+
+
+//      Function : rank
+//      Abstract : The lexicographical index of comb among the M-element
+//      subsets of {0,...,n-1}. The combinations after comb are those
+//      that, at some position, exceed comb and agree before it, so
+//      rank = C(n,M) - 1 - sum over positions p of C(n-1-comb[p], M-p).
+template <size_t M>
+constexpr size_t
+rank(const FixedCombination<M> &comb, const size_t n)
+{
+  size_t after = 0;
+  for (size_t pos = 0; pos < M; ++pos) {
+    after += binomial(n-1-comb[pos], M-pos);
+  } // for
+  return binomial(n, M) - 1 - after;
+} // rank
+
+
+//      Function : combinationTable
+//      Abstract : All M-element subsets of {0,...,N-1} in
+//      lexicographical order. Intended for constexpr variables.
+template <size_t N, size_t M>
+constexpr std::array<FixedCombination<M>, binomial(N, M)>
+combinationTable()
+{
+  std::array<FixedCombination<M>, binomial(N, M)> table{};
+  FixedCombination<M> comb{};
+  for (size_t i = 0; i < M; ++i) {
+    comb[i] = i;
+  } // for
+  for (auto &entry : table) {
+    entry = comb;
+    successor(comb, N);
+  } // for each entry
+  return table;
+} // combinationTable
+
+
+//      Function : next_combination
+//      Abstract : Find the rightmost index below its maximum, which
+//      is n-1 for the last position, n-2 for the one before and so
+//      on. Increment it and let the ones after it follow it. The scan
+//      stops at the first movable index from the right, so stepping
+//      through all combinations is amortized O(1) per step.
+template <class BidirIt>
+constexpr bool
+next_combination(BidirIt first, BidirIt last,
+                 typename std::iterator_traits<BidirIt>::value_type n)
+{
+  using Index = typename std::iterator_traits<BidirIt>::value_type;
+  Index max = n;
+  for (BidirIt it = last; it != first;) {
+    --it;
+    --max;
+    if (*it < max) {
+      for (Index next = *it + 1; it != last; ++it, ++next) {
+        *it = next;
+      } // for
+      return true;
+    } // if
+  } // for
+  Index next = 0;
+  for (BidirIt it = first; it != last; ++it, ++next) {
+    *it = next;
+  } // for
+  return false;
+} // next_combination
+
+
+//      Function : prev_combination
+//      Abstract : Find the rightmost index above its minimum, which
+//      is one past the index before it. Decrement it and move the
+//      ones after it to their maxima.
+template <class BidirIt>
+constexpr bool
+prev_combination(BidirIt first, BidirIt last,
+                 typename std::iterator_traits<BidirIt>::value_type n)
+{
+  using Index = typename std::iterator_traits<BidirIt>::value_type;
+  for (BidirIt it = last; it != first;) {
+    --it;
+    Index min = it == first ? 0 : *std::prev(it) + 1;
+    if (*it > min) {
+      --*it;
+      Index max = n;
+      for (BidirIt back = last; --back != it;) {
+        *back = --max;
+      } // for
+      return true;
+    } // if
+  } // for
+  Index max = n;
+  for (BidirIt back = last; back != first;) {
+    *--back = --max;
+  } // for
+  return false;
+} // prev_combination
+
+
 //      Function : Counter::count
 //      Abstract : Return the number of combinations of m elements
-//      from an n-element set. Throws an overflow error if an overflow
-//      is detected.
-inline size_t
-Counter::count(const size_t n, const size_t m)
+//      from an n-element set, which is zero if m > n. Throws an
+//      overflow error if an overflow is detected.
+template <class Alloc>
+size_t
+BasicCounter<Alloc>::count(const size_t n, const size_t m)
 {
+  if (m > n) {
+    return 0;
+  } // if
   return countRec(n, m);
 } // Counter::count
 
@@ -186,8 +821,9 @@ Counter::count(const size_t n, const size_t m)
 //      formula C(n,m) = C(n-1,m) + C(n-1,m-1) so no factorials are
 //      directly computed. Throws an overflow error if an overflow
 //      is detected.
-inline size_t
-Counter::countRec(const size_t n, size_t m)
+template <class Alloc>
+size_t
+BasicCounter<Alloc>::countRec(const size_t n, size_t m)
 {
   m = std::min(m, n-m);
   if (m == 0) {
@@ -215,70 +851,420 @@ Counter::countRec(const size_t n, size_t m)
 
 //      Function : Enumerator<T>::first
 //      Abstract : Starts the enumerator and returns the first
-//      combination. If m is zero, the null set is returned.
-template <class T>
-auto Enumerator<T>::first(const size_t m) -> Set
+//      combination. If m is zero, the null set is returned. The state
+//      is the m indices of the current combination, so this is O(m)
+//      however large the set.
+template <class T, class Alloc>
+auto Enumerator<T, Alloc>::first(const size_t m) -> Set
 {
+  COMBINATIONS_TRACE_SCOPE("Enumerator::first");
   _m = m;
   _curSet.clear();
-  _idxStack.clear();
-  _idxStack.push_back(0);
-  _stateStack.clear();
-  _stateStack.resize(_set.size()+1, 0);
-
-  if (_m) {
-    return next();
-  } else {
+  _idx.clear();
+  if (_m == 0 || _m > _set.size()) {
     return _curSet;
   } // if
+
+  for (size_t i = 0; i < _m; ++i) {
+    _idx.push_back(i);
+    _curSet.push_back(_set[i]);
+  } // for
+  return _curSet;
 } // Enumerator<T>::first
 
 
 //      Function : Enumerator<T>::next
 //      Abstract : Returns the next combination. If there are no more
 //      combinations, the null set is returned.
-template <class T>
-auto Enumerator<T>::next() -> Set
-{
-  while (_idxStack.size()) {
-    size_t curIdx = _idxStack.back();
-    int state = _stateStack[curIdx];
-    if (state == 0) {
-      if (_curSet.size() < _m) {
-        _curSet.push_back(_set[curIdx]);
-        _idxStack.push_back(curIdx+1);
-        _stateStack[curIdx] = 1;
-      } else {
-        assert(state == 0);
-        _idxStack.pop_back();
-        return _curSet;
-      } // if
-    } else if (state == 1) {
-      _curSet.pop_back();
-      if (curIdx + (_m-_curSet.size()) < _set.size()) {
-        _idxStack.push_back(curIdx+1);
-        _stateStack[curIdx] = 2;
-      } else {
-        _idxStack.pop_back();
-        _stateStack[curIdx] = 0;
-      } // if
-    } else {
-      assert(state == 2);
-      _idxStack.pop_back();
-      _stateStack[curIdx] = 0;
-    } // if
+template <class T, class Alloc>
+auto Enumerator<T, Alloc>::next() -> Set
+{
+  return advance(_idx.size());
+} // Enumerator<T>::next
+
+
+//      Function : Enumerator<T>::skip
+//      Abstract : Skips the remaining combinations that share the
+//      first k indices of the current one and returns the one after
+//      them, or the null set if there is none. Lexor::prefixRange
+//      tells how many were skipped. Skipping with k = m is next().
+template <class T, class Alloc>
+auto Enumerator<T, Alloc>::skip(const size_t k) -> Set
+{
+  return advance(std::min(k, _idx.size()));
+} // Enumerator<T>::skip
+
+
+//      Function : Enumerator<T>::advance
+//      Abstract : The rightmost of the first i indices that can still
+//      move is incremented and the ones after it follow it; only
+//      their elements are replaced.
+template <class T, class Alloc>
+auto Enumerator<T, Alloc>::advance(size_t i) -> Set
+{
+  const size_t n = _set.size();
+  while (i > 0 && _idx[i-1] == n - _m + i - 1) {
+    --i;
   } // while
+  if (i == 0) {
+    _idx.clear();
+    _curSet.clear();
+    return _curSet;
+  } // if
 
-  assert(_curSet.size() == 0);
+  while (_curSet.size() >= i) {
+    _curSet.pop_back();
+  } // while
+  size_t next = ++_idx[i-1];
+  _curSet.push_back(_set[next]);
+  for (size_t j = i; j < _m; ++j) {
+    _idx[j] = ++next;
+    _curSet.push_back(_set[next]);
+  } // for
   return _curSet;
-} // Enumerator<T>::next
+} // Enumerator<T>::advance
+
+
+//      Function : BestFirstEnumerator::BestFirstEnumerator
+//      Abstract : Rank the elements by weight. Throws
+//      std::invalid_argument unless there is one weight per element.
+template <class T, class W, class Alloc>
+BestFirstEnumerator<T, W, Alloc>::BestFirstEnumerator(
+  const Set &set, const Weights &weights, const Alloc &alloc) :
+  _set(set), _weights(weights), _m(0), _weight(), _curSet(alloc),
+  _order(alloc), _ranks(alloc), _heap(alloc), _idx(alloc)
+{
+  if (weights.size() != set.size()) {
+    throw std::invalid_argument("Need one weight per element.");
+  } // if
+  _order.resize(set.size());
+  std::iota(_order.begin(), _order.end(), 0);
+  std::stable_sort(_order.begin(), _order.end(),
+                   [&](size_t a, size_t b) { return weights[a] < weights[b]; });
+} // BestFirstEnumerator::BestFirstEnumerator
+
+
+//      Function : BestFirstEnumerator::first
+//      Abstract : Starts the enumerator with the m lightest elements
+//      and returns them. If m is zero or exceeds the set size, the
+//      null set is returned.
+template <class T, class W, class Alloc>
+auto BestFirstEnumerator<T, W, Alloc>::first(const size_t m) -> Set
+{
+  COMBINATIONS_TRACE_SCOPE("BestFirstEnumerator::first");
+  _m = m;
+  _ranks.clear();
+  _heap.clear();
+  if (_m == 0 || _m > _set.size()) {
+    _curSet.clear();
+    return _curSet;
+  } // if
+
+  W weight = W();
+  for (size_t r = 0; r < _m; ++r) {
+    _ranks.push_back(r);
+    weight += _weights[_order[r]];
+  } // for
+  _heap.push_back(Node{weight, 0, _m-1});
+  return next();
+} // BestFirstEnumerator::first
+
+
+//      Function : BestFirstEnumerator::next
+//      Abstract : Returns the lightest subset not yet produced and
+//      queues its children, or the null set when all have been
+//      produced.
+template <class T, class W, class Alloc>
+auto BestFirstEnumerator<T, W, Alloc>::next() -> Set
+{
+  _curSet.clear();
+  if (_heap.empty()) {
+    return _curSet;
+  } // if
+  std::pop_heap(_heap.begin(), _heap.end(),
+                [this](const Node &a, const Node &b) {
+                  return heavier(a, b); });
+  Node node = _heap.back();
+  _heap.pop_back();
+
+  // Pushing may move _ranks, so decide on both children first.
+  const size_t *ranks = _ranks.data() + node.offset;
+  size_t j = node.active;
+  size_t bound = j+1 < _m ? ranks[j+1] : _set.size();
+  bool moveActive = ranks[j] + 1 < bound;
+  bool moveLeft = j > 0 && ranks[j-1] + 1 < ranks[j];
+  if (moveActive) {
+    push(node, j, j);
+  } // if
+  if (moveLeft) {
+    push(node, j-1, j-1);
+  } // if
+
+  _weight = node.weight;
+  ranks = _ranks.data() + node.offset;
+  _idx.clear();
+  for (size_t p = 0; p < _m; ++p) {
+    _idx.push_back(_order[ranks[p]]);
+  } // for
+  std::sort(_idx.begin(), _idx.end());
+  for (size_t idx : _idx) {
+    _curSet.push_back(_set[idx]);
+  } // for each index
+  return _curSet;
+} // BestFirstEnumerator::next
+
+
+//      Function : BestFirstEnumerator::push
+//      Abstract : Queue the child of parent with the rank at pos
+//      incremented and the given active position.
+template <class T, class W, class Alloc>
+void
+BestFirstEnumerator<T, W, Alloc>::push(const Node &parent, const size_t pos,
+                                       const size_t active)
+{
+  size_t offset = _ranks.size();
+  _ranks.resize(offset + _m);
+  std::copy_n(_ranks.begin() + parent.offset, _m, _ranks.begin() + offset);
+  size_t &rank = _ranks[offset + pos];
+  W weight = parent.weight - _weights[_order[rank]];
+  weight += _weights[_order[++rank]];
+  _heap.push_back(Node{weight, offset, active});
+  std::push_heap(_heap.begin(), _heap.end(),
+                 [this](const Node &a, const Node &b) {
+                   return heavier(a, b); });
+} // BestFirstEnumerator::push
+
+
+//      Function : BestFirstEnumerator::heavier
+//      Abstract : Heap order: by weight, then by ranks.
+template <class T, class W, class Alloc>
+bool
+BestFirstEnumerator<T, W, Alloc>::heavier(const Node &a,
+                                          const Node &b) const
+{
+  if (a.weight != b.weight) {
+    return a.weight > b.weight;
+  } // if
+  return std::lexicographical_compare(
+    _ranks.begin() + b.offset, _ranks.begin() + b.offset + _m,
+    _ranks.begin() + a.offset, _ranks.begin() + a.offset + _m);
+} // BestFirstEnumerator::heavier
+
+
+//      Function : FixedEnumerator<T, M>::first
+//      Abstract : Starts the enumerator at {0, 1, ..., M-1}. Returns
+//      false if the set has fewer than M elements.
+template <class T, size_t M, class Alloc>
+constexpr bool
+FixedEnumerator<T, M, Alloc>::first()
+{
+  for (uint32_t i = 0; i < M; ++i) {
+    _idx[i] = i;
+  } // for
+  return M <= _n;
+} // FixedEnumerator<T, M>::first
+
+
+//      Function : FixedEnumerator<T, M>::next
+//      Abstract : Advances to the next combination. Returns false,
+//      leaving the combination unchanged, after the last one.
+template <class T, size_t M, class Alloc>
+constexpr bool
+FixedEnumerator<T, M, Alloc>::next()
+{
+  return successor(_idx, _n);
+} // FixedEnumerator<T, M>::next
+
+
+//      Function : FixedEnumerator<T, M>::get
+//      Abstract : The elements of the current combination.
+template <class T, size_t M, class Alloc>
+constexpr auto FixedEnumerator<T, M, Alloc>::get() const -> Elements
+{
+  return [this]<size_t... I>(std::index_sequence<I...>) {
+    return Elements{_set[_idx[I]]...};
+  }(std::make_index_sequence<M>());
+} // FixedEnumerator<T, M>::get
+
+
+//      Function : Combination<T, N, Alloc>::Combination
+//      Abstract : Construct from a list of elements.
+template <class T, size_t N, class Alloc>
+Combination<T, N, Alloc>::Combination(std::initializer_list<T> init,
+                                      const Alloc &alloc) :
+  Combination(alloc)
+{
+  reserve(init.size());
+  for (const T &elem : init) {
+    push_back(elem);
+  } // for each element
+} // Combination<T, N, Alloc>::Combination
+
+
+//      Function : Combination<T, N, Alloc>::Combination
+//      Abstract : Copy constructor with an allocator.
+template <class T, size_t N, class Alloc>
+Combination<T, N, Alloc>::Combination(const Combination &other,
+                                      const Alloc &alloc) :
+  Combination(alloc)
+{
+  reserve(other._size);
+  for (const T &elem : other) {
+    push_back(elem);
+  } // for each element
+} // Combination<T, N, Alloc>::Combination
+
+
+//      Function : Combination<T, N, Alloc>::Combination
+//      Abstract : Move constructor with an allocator.
+template <class T, size_t N, class Alloc>
+Combination<T, N, Alloc>::Combination(Combination &&other,
+                                      const Alloc &alloc)
+  noexcept(NOTHROW_TAKE) :
+  Combination(alloc)
+{
+  take(std::move(other));
+} // Combination<T, N, Alloc>::Combination
+
+
+//      Function : Combination<T, N, Alloc>::~Combination
+//      Abstract : Destroy the elements and free any heap buffer.
+template <class T, size_t N, class Alloc>
+Combination<T, N, Alloc>::~Combination()
+{
+  release();
+} // Combination<T, N, Alloc>::~Combination
+
+
+//      Function : Combination<T, N, Alloc>::operator=
+//      Abstract : Copy assignment. The allocator is not propagated.
+template <class T, size_t N, class Alloc>
+auto Combination<T, N, Alloc>::operator=(const Combination &other)
+  -> Combination &
+{
+  if (this != &other) {
+    clear();
+    reserve(other._size);
+    for (const T &elem : other) {
+      push_back(elem);
+    } // for each element
+  } // if
+  return *this;
+} // Combination<T, N, Alloc>::operator=
+
+
+//      Function : Combination<T, N, Alloc>::operator=
+//      Abstract : Move assignment. The allocator is not propagated.
+template <class T, size_t N, class Alloc>
+auto Combination<T, N, Alloc>::operator=(Combination &&other)
+  noexcept(NOTHROW_TAKE) -> Combination &
+{
+  if (this != &other) {
+    release();
+    take(std::move(other));
+  } // if
+  return *this;
+} // Combination<T, N, Alloc>::operator=
+
+
+//      Function : Combination<T, N, Alloc>::reserve
+//      Abstract : Make room for capacity elements, moving them to the
+//      heap if they no longer fit inline.
+template <class T, size_t N, class Alloc>
+void
+Combination<T, N, Alloc>::reserve(const size_t capacity)
+{
+  if (capacity <= _capacity) {
+    return;
+  } // if
+  T *data = AllocTraits::allocate(_alloc, capacity);
+  for (size_t i = 0; i < _size; ++i) {
+    new (data + i) T(std::move(_data[i]));
+    _data[i].~T();
+  } // for
+  if (! isInline()) {
+    AllocTraits::deallocate(_alloc, _data, _capacity);
+  } // if
+  _data = data;
+  _capacity = capacity;
+} // Combination<T, N, Alloc>::reserve
+
+
+//      Function : Combination<T, N, Alloc>::clear
+//      Abstract : Destroy the elements, keeping the capacity.
+template <class T, size_t N, class Alloc>
+void
+Combination<T, N, Alloc>::clear()
+{
+  while (_size) {
+    pop_back();
+  } // while
+} // Combination<T, N, Alloc>::clear
+
+
+//      Function : Combination<T, N, Alloc>::push_back
+//      Abstract : Append an element, doubling the capacity if full.
+template <class T, size_t N, class Alloc>
+void
+Combination<T, N, Alloc>::push_back(const T &elem)
+{
+  if (_size == _capacity) {
+    T copy(elem); // elem may refer into this combination.
+    reserve(2 * _capacity);
+    new (_data + _size++) T(std::move(copy));
+  } else {
+    new (_data + _size++) T(elem);
+  } // if
+} // Combination<T, N, Alloc>::push_back
+
+
+//      Function : Combination<T, N, Alloc>::release
+//      Abstract : Destroy the elements and free any heap buffer,
+//      returning to empty inline storage.
+template <class T, size_t N, class Alloc>
+void
+Combination<T, N, Alloc>::release()
+{
+  clear();
+  if (! isInline()) {
+    AllocTraits::deallocate(_alloc, _data, _capacity);
+    _data = inlineData();
+    _capacity = N;
+  } // if
+} // Combination<T, N, Alloc>::release
+
+
+//      Function : Combination<T, N, Alloc>::take
+//      Abstract : Take the contents of other, which is left empty.
+//      This combination must be empty and inline. A heap buffer is
+//      stolen only if it can be freed through our allocator.
+template <class T, size_t N, class Alloc>
+void
+Combination<T, N, Alloc>::take(Combination &&other)
+{
+  if (other.isInline() || _alloc != other._alloc) {
+    reserve(other._size);
+    for (size_t i = 0; i < other._size; ++i) {
+      new (_data + i) T(std::move(other._data[i]));
+    } // for
+    _size = other._size;
+    other.clear();
+  } else {
+    _data = other._data;
+    _size = other._size;
+    _capacity = other._capacity;
+    other._data = other.inlineData();
+    other._size = 0;
+    other._capacity = N;
+  } // if
+} // Combination<T, N, Alloc>::take
 
 
 //      Function : Lexor::setM
 //      Abstract : Sets the size of the subset for subsequent get() calls.
-template <class T>
+template <class T, class C, class Alloc>
 void
-Lexor<T>::setM(const size_t m)
+Lexor<T, C, Alloc>::setM(const size_t m)
 {
   _m = m;
 } // Lexor::setM
@@ -289,10 +1275,11 @@ Lexor<T>::setM(const size_t m)
 //      {0,...,n-1}. The first subset in the order is indexed by 0;
 //      the last is C(n, m)-1. If i is out of range, then we return an
 //      empty vector. This sets m for subsequent calls as a side effect.
-template <class T>
-std::vector<T>
-Lexor<T>::get(const size_t i, const size_t m)
+template <class T, class C, class Alloc>
+C
+Lexor<T, C, Alloc>::get(const size_t i, const size_t m)
 {
+  COMBINATIONS_TRACE_SCOPE("Lexor::get(i, m)");
   _m = m;
   return get(i);
 } // Lexor::get
@@ -303,30 +1290,63 @@ Lexor<T>::get(const size_t i, const size_t m)
 //      {0,...,n-1}. The first subset in the order is indexed by 0;
 //      the last is C(n, m)-1. If i is out of range, then we return an
 //      empty vector.
-template <class T>
-std::vector<T>
-Lexor<T>::get(const size_t i)
+template <class T, class C, class Alloc>
+C
+Lexor<T, C, Alloc>::get(const size_t i)
 {
-  std::vector<T> result;
-  if (i < _counter.count(_n, _m)) {
-    get(_n, _m, i, 0, result);
+  C result(_alloc);
+  if (size_t count = _counter.count(_n, _m); i < count) {
+    if (_n <= detail::SMALL_N) {
+      getSmall(i, count, result);
+    } else {
+      get(_n, _m, i, 0, result);
+    } // if
   } // if
   return result;
 } // Lexor::get
 
 
+//      Function : Lexor::prefixRange
+//      Abstract : The ranks [begin, end) of the m-element subsets
+//      whose first indices are the ascending prefix. At position k,
+//      the subsets with a smaller index v in [next, prefix[k]) come
+//      first; there are sum C(n-1-v, m-k-1) = C(n-next, m-k) -
+//      C(n-prefix[k], m-k) of them, so this takes O(|prefix|) table
+//      lookups. Throws std::invalid_argument if the prefix is not
+//      ascending, out of range or longer than m.
+template <class T, class C, class Alloc>
+template <class Indices>
+std::pair<size_t, size_t>
+Lexor<T, C, Alloc>::prefixRange(const Indices &prefix)
+{
+  size_t begin = 0;
+  size_t next = 0;
+  size_t k = 0;
+  for (size_t idx : prefix) {
+    if (idx < next || idx >= _n || k >= _m) {
+      throw std::invalid_argument("Invalid combination prefix.");
+    } // if
+    begin += _counter.count(_n - next, _m - k) -
+      _counter.count(_n - idx, _m - k);
+    next = idx + 1;
+    ++k;
+  } // for each index
+  return {begin, begin + _counter.count(_n - next, _m - k)};
+} // Lexor::prefixRange
+
+
 //      Function : Lexor::get
 //      Abstract : Get the i-th m-element subset of the n-element set
 //      {0,...,n-1}. Parameter i is then next element we are
 //      considering adding to the returned subset. Parameter r is the
 //      returned subset.
-template <class T>
+template <class T, class C, class Alloc>
 void
-Lexor<T>::get(const size_t n,
-              const size_t m,
-              const size_t i,
-              const size_t nel,
-              std::vector<T> &r)
+Lexor<T, C, Alloc>::get(const size_t n,
+                 const size_t m,
+                 const size_t i,
+                 const size_t nel,
+                 C &r)
 {
   if (m > 0) {
     assert(nel < _n);
@@ -342,16 +1362,43 @@ Lexor<T>::get(const size_t n,
 } // Lexor::get
 
 
+//      Function : Lexor::getSmall
+//      Abstract : Get the i-th subset for n <= SMALL_N by lookups.
+//      With k positions left after element s-1 and t = C(n-s, k) - i',
+//      i' being i less the subsets skipped so far, the next element
+//      is v with C(n-1-v, k) < t <= C(n-v, k), i.e. v = n minus the
+//      number of a with C(a, k) < t, which countLess finds in row k.
+//      Skipping the subsets that start with smaller elements then
+//      leaves t - C(n-1-v, k) for the next position.
+template <class T, class C, class Alloc>
+void
+Lexor<T, C, Alloc>::getSmall(const size_t i, const size_t count, C &r)
+{
+  const auto &rows = detail::SMALL_BINOMIALS.rows;
+  uint32_t t = uint32_t(count - i);
+  r.reserve(_m);
+  for (size_t k = _m; k > 0; --k) {
+    size_t v = _n - detail::countLess(rows[k], t);
+    r.push_back(_set[v]);
+    t -= rows[k][_n - 1 - v];
+  } // for each position
+} // Lexor::getSmall
+
+
 //      Function : Generator<T>::generate
 //      Abstract : Generate all m-element subsets of the set.
-template <class T>
+template <class T, class C, class Alloc>
 void
-Generator<T>::generate(const size_t m)
+Generator<T, C, Alloc>::generate(const size_t m)
 {
+  COMBINATIONS_TRACE_SCOPE("Generator::generate");
   _combinations.clear();
-  _combinations.reserve(Counter().count(_set.size(), m));
+  _combinations.reserve(binomial(_set.size(), m));
   _m = m;
-  Set curSet;
+  if (m > _set.size()) {
+    return;
+  } // if
+  C curSet(_alloc);
   curSet.reserve(m);
   generateRec(0, curSet);
 } // Generator<T>::generate
@@ -359,9 +1406,9 @@ Generator<T>::generate(const size_t m)
 
 //      Function : Generator<T>::generateRec
 //      Abstract : Recursive enumeration.
-template <class T>
+template <class T, class C, class Alloc>
 void
-Generator<T>::generateRec(const size_t curIdx, Set &curSet)
+Generator<T, C, Alloc>::generateRec(const size_t curIdx, C &curSet)
 {
   if (curSet.size() < _m) {
     curSet.push_back(_set[curIdx]);
@@ -377,6 +1424,135 @@ Generator<T>::generateRec(const size_t curIdx, Set &curSet)
 } // Generator<T>::generateRec
 
 
+//      Function : TrieGenerator<T>::generate
+//      Abstract : Step through the combinations with next_combination
+//      and append a node at each level from the first index that
+//      changed on. Level d has C(n-m+d+1, d+1) nodes, the prefixes
+//      whose elements are all at most n-m+d, so the arrays are sized
+//      exactly up front. Throws a length error if a level has more
+//      nodes than 32-bit indices can address.
+template <class T, class C, class Alloc>
+void
+TrieGenerator<T, C, Alloc>::generate(const size_t m)
+{
+  COMBINATIONS_TRACE_SCOPE("TrieGenerator::generate");
+  const size_t n = _set.size();
+  _m = m;
+  _size = m > n ? 0 : binomial(n, m);
+  _levels.assign(1, 0);
+  _nodes.clear();
+  if (m == 0 || m > n) {
+    return;
+  } // if
+  if (_size > UINT32_MAX) {
+    throw std::length_error("Too many combinations for a trie.");
+  } // if
+  for (size_t d = 0; d < m; ++d) {
+    _levels.push_back(_levels.back() + binomial(n - m + d + 1, d + 1));
+  } // for
+  _nodes.resize(_levels.back());
+
+  IndexAlloc indexAlloc(_alloc);
+  std::vector<uint32_t, IndexAlloc> idx(m, 0, indexAlloc), prev(indexAlloc),
+    count(m, 0, indexAlloc);
+  std::iota(idx.begin(), idx.end(), 0);
+  size_t changed = 0;
+  do {
+    for (size_t d = changed; d < m; ++d) {
+      size_t node = _levels[d] + count[d]++;
+      _nodes[node] = Node{idx[d], d == 0 ? 0 : count[d-1] - 1};
+    } // for
+    prev = idx;
+    if (! next_combination(idx.begin(), idx.end(), uint32_t(n))) {
+      break;
+    } // if
+    changed = 0;
+    while (idx[changed] == prev[changed]) {
+      ++changed;
+    } // while
+  } while (true);
+} // TrieGenerator<T>::generate
+
+
+//      Function : TrieGenerator<T>::indices
+//      Abstract : The m indices of the combination of a given rank,
+//      from the leaf up its parents. O(m).
+template <class T, class C, class Alloc>
+void
+TrieGenerator<T, C, Alloc>::indices(const size_t rank, uint32_t *idx) const
+{
+  assert(rank < _size);
+  size_t node = rank;
+  for (size_t d = _m; d-- > 0;) {
+    const Node &cur = _nodes[_levels[d] + node];
+    idx[d] = cur.element;
+    node = cur.parent;
+  } // for
+} // TrieGenerator<T>::indices
+
+
+//      Function : TrieGenerator<T>::get
+//      Abstract : The combination of a given rank as elements of the
+//      set. If the rank is out of range, it is empty.
+template <class T, class C, class Alloc>
+C
+TrieGenerator<T, C, Alloc>::get(const size_t rank) const
+{
+  C result(_alloc);
+  if (rank >= _size || _m == 0) {
+    return result;
+  } // if
+  // Fill in from the leaf up, over placeholders.
+  result.reserve(_m);
+  for (size_t d = 0; d < _m; ++d) {
+    result.push_back(_set[0]);
+  } // for
+  size_t node = rank;
+  for (size_t d = _m; d-- > 0;) {
+    const Node &cur = _nodes[_levels[d] + node];
+    result[d] = _set[cur.element];
+    node = cur.parent;
+  } // for
+  return result;
+} // TrieGenerator<T>::get
+
+
+//      Function : TrieGenerator<T>::forEach
+//      Abstract : Call fn(combination) for each combination in order.
+//      Going from one leaf to the next, only the levels whose node
+//      changes are updated, which are found by walking up until the
+//      parents agree, so a step is O(1) amortized.
+template <class T, class C, class Alloc>
+template <class Fn>
+void
+TrieGenerator<T, C, Alloc>::forEach(Fn fn) const
+{
+  COMBINATIONS_TRACE_SCOPE("TrieGenerator::forEach");
+  if (_size == 0 || _m == 0) {
+    if (_size == 1) {
+      fn(static_cast<const C &>(C(_alloc))); // The empty combination.
+    } // if
+    return;
+  } // if
+  std::vector<size_t, OffsetAlloc> nodes(_m, SIZE_MAX, OffsetAlloc(_alloc));
+  C cur(_alloc);
+  cur.reserve(_m);
+  for (size_t d = 0; d < _m; ++d) {
+    cur.push_back(_set[0]);
+  } // for
+  for (size_t leaf = 0; leaf < _size; ++leaf) {
+    size_t node = leaf;
+    for (size_t d = _m; d-- > 0 && nodes[d] != node;) {
+      nodes[d] = node;
+      const Node &trie = _nodes[_levels[d] + node];
+      cur[d] = _set[trie.element];
+      node = trie.parent;
+    } // for
+    fn(static_cast<const C &>(cur));
+  } // for each leaf
+} // TrieGenerator<T>::forEach
+
+
 } // namespace combinations
 
 #endif // COMBINATIONS_H
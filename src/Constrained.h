@@ -0,0 +1,273 @@
+//
+//      File     : Constrained.h
+//      Abstract : Counting, ranking and unranking of the m-element
+//      subsets of a weighted set that satisfy an additive constraint,
+//      such as total weight <= W or weight sum = r mod k. A dynamic
+//      program over (elements, size, constraint state) extends the
+//      recurrence C(n,m) = C(n-1,m) + C(n-1,m-1) of Counter, so the
+//      valid subsets are counted exactly without enumerating them and
+//      can be split into even shards by rank.
+//
+
+#ifndef CONSTRAINED_H
+#define CONSTRAINED_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "TraceScope.h"
+
+namespace combinations {
+namespace constraints {
+
+// State returned by step() when a subset can no longer be valid.
+constexpr size_t NONE = SIZE_MAX;
+
+//      Struct   : AtMost
+//      Abstract : Total weight at most capacity, for nonnegative
+//      weights. The state is the weight so far. A negative capacity
+//      has no states.
+struct AtMost {
+  int64_t capacity;
+
+  size_t states() const {
+    return capacity < 0 ? 0 : size_t(capacity) + 1; };
+  size_t initial() const { return 0; };
+  size_t step(size_t state, int64_t w) const {
+    return w >= 0 && int64_t(state) + w <= capacity ?
+      state + size_t(w) : NONE; };
+  bool accept(size_t) const { return true; };
+}; // AtMost
+
+
+//      Struct   : Modulo
+//      Abstract : Weight sum congruent to residue modulo modulus. The
+//      state is the sum so far modulo modulus. A modulus below 1 has
+//      no states.
+struct Modulo {
+  int64_t modulus;
+  int64_t residue;
+
+  size_t states() const { return modulus <= 0 ? 0 : size_t(modulus); };
+  size_t initial() const { return 0; };
+  size_t step(size_t state, int64_t w) const {
+    return size_t(((int64_t(state) + w) % modulus + modulus) % modulus); };
+  bool accept(size_t state) const {
+    return int64_t(state) == (residue % modulus + modulus) % modulus; };
+}; // Modulo
+
+} // namespace constraints
+
+
+//      Class    : ConstrainedCounter
+//      Abstract : The valid m-subsets of a weighted set, ordered
+//      lexicographically by their ascending element indices. A
+//      Constraint has states() states numbered from 0, an initial()
+//      state, step(state, weight) giving the state after adding an
+//      element or constraints::NONE, and accept(state) for complete
+//      subsets; a constraint with no states is invalid. The table
+//      holds (n+1)*(m+1)*states() counts, so state spaces should stay
+//      moderate.
+template <class Constraint>
+class ConstrainedCounter {
+public:
+  using Weights = std::vector<int64_t>;
+  using Indices = std::vector<size_t>;
+
+  ConstrainedCounter(const Weights &weights, size_t m,
+                     const Constraint &constraint); // CTOR
+  ~ConstrainedCounter() = default; // DTOR
+
+  uint64_t count() const { return at(0, _m, _constraint.initial()); };
+  uint64_t rank(const Indices &idx) const;
+  Indices unrank(uint64_t rank) const;
+  bool next(Indices &idx);
+
+  ConstrainedCounter(const ConstrainedCounter &) = delete; // Copy CTOR
+  ConstrainedCounter &operator=(const ConstrainedCounter &) =
+    delete; // Copy assignment
+  ConstrainedCounter(ConstrainedCounter &&) = delete; // Move CTOR
+  ConstrainedCounter &operator=(ConstrainedCounter &&) =
+    delete; // Move assignment
+private:
+  // Valid completions with j elements from [i, n) in state s.
+  uint64_t at(size_t i, size_t j, size_t s) const {
+    return _counts[(i * (_m + 1) + j) * _states + s]; };
+  // Completions after taking element y at position p in state s.
+  uint64_t after(size_t y, size_t p, size_t s) const;
+  bool fill(Indices &idx, size_t p, size_t start, size_t s) const;
+
+  const Weights &_weights;
+  size_t _n;
+  size_t _m;
+  Constraint _constraint;
+  size_t _states;
+  std::vector<uint64_t> _counts;
+  std::vector<size_t> _path; // States before each position, for next().
+}; // ConstrainedCounter
+
+
+//      Function : ConstrainedCounter::ConstrainedCounter
+//      Abstract : Fill the table from the last element back. Taking
+//      element i moves to step(s, w_i); not taking it keeps s. Throws
+//      an invalid argument error if the constraint has no states, and
+//      an overflow error if a count overflows.
+template <class Constraint>
+ConstrainedCounter<Constraint>::ConstrainedCounter(
+  const Weights &weights, const size_t m, const Constraint &constraint) :
+  _weights(weights), _n(weights.size()), _m(m), _constraint(constraint),
+  _states(constraint.states()), _path(m + 1)
+{
+  COMBINATIONS_TRACE_SCOPE("ConstrainedCounter::ConstrainedCounter");
+  if (_states == 0) {
+    throw std::invalid_argument("Constraint has no states.");
+  } // if
+  _counts.assign((_n + 1) * (_m + 1) * _states, 0);
+  for (size_t i = _n + 1; i-- > 0;) {
+    for (size_t s = 0; s < _states; ++s) {
+      _counts[i * (_m + 1) * _states + s] = _constraint.accept(s);
+    } // for each state
+    if (i == _n) {
+      continue;
+    } // if
+    for (size_t j = 1; j <= _m; ++j) {
+      for (size_t s = 0; s < _states; ++s) {
+        uint64_t cnt0 = at(i + 1, j, s);
+        size_t t = _constraint.step(s, _weights[i]);
+        uint64_t cnt1 = t == constraints::NONE ? 0 : at(i + 1, j - 1, t);
+        uint64_t cnt = cnt0 + cnt1;
+        if (cnt < cnt0) {
+          throw std::overflow_error("Combination size overflowed.");
+        } // if
+        _counts[(i * (_m + 1) + j) * _states + s] = cnt;
+      } // for each state
+    } // for
+  } // for each element
+} // ConstrainedCounter::ConstrainedCounter
+
+
+//      Function : ConstrainedCounter::after
+//      Abstract : Number of valid subsets whose element at position p
+//      is y, given the state s before it and the elements before it.
+template <class Constraint>
+uint64_t
+ConstrainedCounter<Constraint>::after(const size_t y, const size_t p,
+                                      const size_t s) const
+{
+  size_t t = _constraint.step(s, _weights[y]);
+  return t == constraints::NONE ? 0 : at(y + 1, _m - p - 1, t);
+} // ConstrainedCounter::after
+
+
+//      Function : ConstrainedCounter::rank
+//      Abstract : Lexicographic rank of a valid subset among the valid
+//      subsets, counting those that take a smaller element at the
+//      first position where they differ. O(n*m).
+template <class Constraint>
+uint64_t
+ConstrainedCounter<Constraint>::rank(const Indices &idx) const
+{
+  if (idx.size() != _m) {
+    throw std::invalid_argument("Subset size doesn't match.");
+  } // if
+  uint64_t result = 0;
+  size_t s = _constraint.initial();
+  size_t start = 0;
+  for (size_t p = 0; p < _m; ++p) {
+    if (idx[p] < start || idx[p] >= _n) {
+      throw std::invalid_argument("Indices not ascending or out of range.");
+    } // if
+    for (size_t y = start; y < idx[p]; ++y) {
+      result += after(y, p, s);
+    } // for
+    s = _constraint.step(s, _weights[idx[p]]);
+    if (s == constraints::NONE) {
+      throw std::invalid_argument("Subset violates the constraint.");
+    } // if
+    start = idx[p] + 1;
+  } // for each position
+  if (! _constraint.accept(s)) {
+    throw std::invalid_argument("Subset violates the constraint.");
+  } // if
+  return result;
+} // ConstrainedCounter::rank
+
+
+//      Function : ConstrainedCounter::unrank
+//      Abstract : The valid subset of a given rank. At each position
+//      skip over elements while the rank exceeds the subsets they
+//      start. O(n*m).
+template <class Constraint>
+auto
+ConstrainedCounter<Constraint>::unrank(uint64_t rank) const -> Indices
+{
+  if (rank >= count()) {
+    throw std::out_of_range("Rank exceeds the number of valid subsets.");
+  } // if
+  Indices idx(_m);
+  size_t s = _constraint.initial();
+  size_t y = 0;
+  for (size_t p = 0; p < _m; ++p, ++y) {
+    for (uint64_t cnt = after(y, p, s); rank >= cnt; cnt = after(y, p, s)) {
+      rank -= cnt;
+      ++y;
+    } // for
+    idx[p] = y;
+    s = _constraint.step(s, _weights[y]);
+  } // for each position
+  return idx;
+} // ConstrainedCounter::unrank
+
+
+//      Function : ConstrainedCounter::next
+//      Abstract : Step idx to the next valid subset in rank order, so
+//      a shard [begin, end) is visited by unrank(begin) and end-begin-1
+//      calls. Elements are only taken where the table shows a valid
+//      completion, so no dead ends are explored and nothing is
+//      allocated. Returns false after the last subset.
+template <class Constraint>
+bool
+ConstrainedCounter<Constraint>::next(Indices &idx)
+{
+  _path[0] = _constraint.initial();
+  for (size_t p = 0; p < _m; ++p) {
+    _path[p + 1] = _constraint.step(_path[p], _weights[idx[p]]);
+  } // for
+  for (size_t p = _m; p-- > 0;) {
+    if (fill(idx, p, idx[p] + 1, _path[p])) {
+      return true;
+    } // if
+  } // for each position
+  return false;
+} // ConstrainedCounter::next
+
+
+//      Function : ConstrainedCounter::fill
+//      Abstract : Set positions p on to the smallest valid completion
+//      with idx[p] >= start, given the state s before position p.
+//      Returns false if there is none.
+template <class Constraint>
+bool
+ConstrainedCounter<Constraint>::fill(Indices &idx, size_t p, size_t start,
+                                     size_t s) const
+{
+  for (; p < _m; ++p) {
+    size_t y = start;
+    while (y < _n && after(y, p, s) == 0) {
+      ++y;
+    } // while
+    if (y == _n) {
+      return false;
+    } // if
+    idx[p] = y;
+    s = _constraint.step(s, _weights[y]);
+    start = y + 1;
+  } // for each position
+  return true;
+} // ConstrainedCounter::fill
+
+} // namespace combinations
+
+#endif // CONSTRAINED_H
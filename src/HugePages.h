@@ -0,0 +1,252 @@
+//
+//      File     : HugePages.h
+//      Abstract : A memory resource backing large allocations with
+//      huge pages to reduce TLB misses on big Generator outputs and
+//      count tables. It is meant as the upstream of an arena, e.g.
+//      a std::pmr::monotonic_buffer_resource used with the
+//      combinations::pmr classes.
+//
+
+#ifndef HUGEPAGES_H
+#define HUGEPAGES_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <unordered_map>
+#include <utility>
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace combinations {
+namespace huge {
+
+//      Enum     : Backing
+//      Abstract : How an allocation is backed, best first. Explicit
+//      pages come from hugetlbfs and must be reserved by the
+//      administrator (vm.nr_hugepages); transparent pages are
+//      requested with madvise(MADV_HUGEPAGE) and may be granted by
+//      the kernel in the background.
+enum class Backing { HUGE_1G, HUGE_2M, TRANSPARENT, NORMAL, NUM_BACKINGS };
+
+constexpr size_t PAGE_4K = size_t(1) << 12;
+constexpr size_t PAGE_2M = size_t(1) << 21;
+constexpr size_t PAGE_1G = size_t(1) << 30;
+
+
+//      Class    : Resource
+//      Abstract : Allocations of at least minBytes are mapped
+//      directly, trying each backing from the preferred one down to
+//      normal pages. Mappings below 2M only get normal pages, so a
+//      small arena chunk never pins a huge page. Allocations below
+//      minBytes are forwarded to upstream. Without mmap all
+//      allocations are forwarded.
+class Resource : public std::pmr::memory_resource {
+public:
+  Resource(Backing preferred = Backing::HUGE_2M,
+           size_t minBytes = size_t(1) << 16,
+           std::pmr::memory_resource *upstream =
+             std::pmr::new_delete_resource()) :
+    _preferred(preferred), _minBytes(minBytes), _upstream(upstream),
+    _bytes{}, _mappings(upstream) {}; // CTOR
+  ~Resource() = default; // DTOR
+
+  // Bytes currently mapped with the given backing.
+  size_t bytes(Backing backing) const {
+    return _bytes[size_t(backing)]; };
+  static const char *name(Backing backing);
+
+  Resource(const Resource &) = delete; // Copy CTOR
+  Resource &operator=(const Resource &) = delete; // Copy assignment
+  Resource(Resource &&) = delete; // Move CTOR
+  Resource &operator=(Resource &&) = delete; // Move assignment
+private:
+  void *do_allocate(size_t bytes, size_t alignment) override;
+  void do_deallocate(void *ptr, size_t bytes, size_t alignment) override;
+  bool do_is_equal(const std::pmr::memory_resource &other)
+    const noexcept override { return this == &other; };
+
+  bool direct(size_t bytes, size_t alignment) const;
+  void *map(size_t length, Backing backing);
+
+  Backing _preferred;
+  size_t _minBytes;
+  std::pmr::memory_resource *_upstream;
+  std::array<size_t, size_t(Backing::NUM_BACKINGS)> _bytes;
+  // Length and backing of each mapping by address.
+  std::pmr::unordered_map<void *, std::pair<size_t, Backing>> _mappings;
+}; // Resource
+
+
+//      Function : pageSize
+//      Abstract : Size of the pages a mapping of bytes with a backing
+//      is rounded up to: normal pages below 2M, 2M-aligned above for
+//      transparent huge pages.
+constexpr size_t
+pageSize(const Backing backing, const size_t bytes)
+{
+  return backing == Backing::HUGE_1G ? PAGE_1G :
+    backing == Backing::HUGE_2M || bytes >= PAGE_2M ? PAGE_2M : PAGE_4K;
+} // pageSize
+
+
+//      Function : roundUp
+//      Abstract : Round bytes up to a multiple of a page size.
+constexpr size_t
+roundUp(const size_t bytes, const size_t page)
+{
+  return (bytes + page - 1) / page * page;
+} // roundUp
+
+
+//      Function : Resource::name
+//      Abstract : Short name of a backing for reports.
+inline const char *
+Resource::name(const Backing backing)
+{
+  static const char *names[size_t(Backing::NUM_BACKINGS)] = {
+    "1G", "2M", "transparent", "normal"
+  };
+  return names[size_t(backing)];
+} // Resource::name
+
+
+//      Function : Resource::direct
+//      Abstract : True if an allocation is mapped rather than
+//      forwarded. It depends only on the arguments, which
+//      deallocation repeats.
+inline bool
+Resource::direct(const size_t bytes, const size_t alignment) const
+{
+#ifdef __linux__
+  return bytes >= _minBytes && alignment <= PAGE_2M;
+#else
+  (void) bytes;
+  (void) alignment;
+  return false;
+#endif
+} // Resource::direct
+
+
+//      Function : Resource::do_allocate
+//      Abstract : Map the allocation with the best backing available,
+//      falling back one backing at a time. A backing is only tried if
+//      the request fills at least one of its pages: below 1G no 1G
+//      pages, below 2M only normal pages.
+inline void *
+Resource::do_allocate(const size_t bytes, const size_t alignment)
+{
+  if (! direct(bytes, alignment)) {
+    return _upstream->allocate(bytes, alignment);
+  } // if
+  Backing first = bytes < PAGE_2M ? Backing::NORMAL :
+    bytes < PAGE_1G ? Backing::HUGE_2M : Backing::HUGE_1G;
+  for (size_t b = std::max(size_t(_preferred), size_t(first));
+       b < size_t(Backing::NUM_BACKINGS); ++b) {
+    if (void *ptr = map(bytes, Backing(b))) {
+      size_t length = roundUp(bytes, pageSize(Backing(b), bytes));
+      try {
+        _mappings.emplace(ptr, std::make_pair(length, Backing(b)));
+      } catch (...) {
+#ifdef __linux__
+        munmap(ptr, length);
+#endif
+        throw;
+      } // try/catch
+      _bytes[b] += length;
+      return ptr;
+    } // if
+  } // for each backing
+  throw std::bad_alloc();
+} // Resource::do_allocate
+
+
+//      Function : Resource::do_deallocate
+//      Abstract : Unmap a mapped allocation; others go back upstream.
+inline void
+Resource::do_deallocate(void *ptr, const size_t bytes,
+                        const size_t alignment)
+{
+  if (! direct(bytes, alignment)) {
+    _upstream->deallocate(ptr, bytes, alignment);
+    return;
+  } // if
+#ifdef __linux__
+  auto it = _mappings.find(ptr);
+  if (it != _mappings.end()) {
+    auto [length, backing] = it->second;
+    munmap(ptr, length);
+    _bytes[size_t(backing)] -= length;
+    _mappings.erase(it);
+  } // if
+#endif
+} // Resource::do_deallocate
+
+
+//      Function : Resource::map
+//      Abstract : Map length bytes rounded up to the page size with
+//      the given backing, or return nullptr if that fails.
+//      Other mappings of 2M or more are over-allocated and trimmed so
+//      that they start on a 2M boundary, where the kernel can use huge
+//      pages.
+inline void *
+Resource::map(const size_t length, const Backing backing)
+{
+#ifdef __linux__
+  const int prot = PROT_READ | PROT_WRITE;
+  const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+  size_t rounded = roundUp(length, pageSize(backing, length));
+  if (backing == Backing::HUGE_1G || backing == Backing::HUGE_2M) {
+#ifdef MAP_HUGETLB
+    int shift = backing == Backing::HUGE_1G ? 30 : 21;
+    void *ptr = mmap(nullptr, rounded, prot,
+                     flags | MAP_HUGETLB | (shift << MAP_HUGE_SHIFT), -1, 0);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+#else
+    return nullptr;
+#endif
+  } // if
+  if (rounded < PAGE_2M) {
+    void *ptr = mmap(nullptr, rounded, prot, flags, -1, 0);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+  } // if
+  void *raw = mmap(nullptr, rounded + PAGE_2M, prot, flags, -1, 0);
+  if (raw == MAP_FAILED) {
+    return nullptr;
+  } // if
+  char *start = static_cast<char *>(raw);
+  char *aligned = reinterpret_cast<char *>(
+    roundUp(reinterpret_cast<uintptr_t>(start), PAGE_2M));
+  if (aligned > start) {
+    munmap(start, aligned - start);
+  } // if
+  munmap(aligned + rounded, start + PAGE_2M - aligned);
+#ifdef MADV_HUGEPAGE
+  if (backing == Backing::TRANSPARENT &&
+      madvise(aligned, rounded, MADV_HUGEPAGE) != 0) {
+    munmap(aligned, rounded);
+    return nullptr;
+  } // if
+#else
+  if (backing == Backing::TRANSPARENT) {
+    munmap(aligned, rounded);
+    return nullptr;
+  } // if
+#endif
+  return aligned;
+#else
+  (void) length;
+  (void) backing;
+  return nullptr;
+#endif
+} // Resource::map
+
+} // namespace huge
+} // namespace combinations
+
+#endif // HUGEPAGES_H
@@ -0,0 +1,473 @@
+//
+//      File     : Kernels.h
+//      Abstract : Hot kernels on index combinations compiled for
+//      several instruction set variants with runtime selection. A
+//      combination is an ascending array of m indices into
+//      {0,...,n-1}.
+//
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#define COMBINATIONS_X86_DISPATCH 1
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__)
+#define COMBINATIONS_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define COMBINATIONS_ALWAYS_INLINE inline
+#endif
+
+namespace combinations {
+namespace kernels {
+
+//      Struct   : KernelTable
+//      Abstract : Entry points for one instruction set variant.
+//
+//      successor : Advance idx to its lexicographic successor. Returns
+//                  false, leaving idx unchanged, after the last one.
+//      unrank    : Fill idx with the combination of the given rank.
+//                  Count must be C(n, m).
+//      toMask    : Bitmask of the indices; requires n <= 64.
+//      fromMask  : Indices of the set bits; returns their number.
+//      batch     : Write up to maxCnt successors of idx to out, m
+//                  indices each, advancing idx. Returns the number
+//                  written; fewer than maxCnt at the end.
+//      deposit   : Scatter the low bits of value to the set bits of
+//                  mask, lowest first (PDEP).
+//      extract   : Gather the bits of value at the set bits of mask
+//                  into the low bits (PEXT).
+//      maskBatch : As batch for subsets of the set bits of mask. The
+//                  subset is kept compacted to the low popcount(mask)
+//                  bits in *compact, which must be nonzero and is
+//                  advanced in colex order; each successor is written
+//                  to out deposited into mask.
+//      fromMasks : fromMask for cnt masks, writing their indices one
+//                  after the other. Returns the total number. Vector
+//                  variants store whole vectors, so out needs room for
+//                  FROM_MASKS_SLACK more indices.
+struct KernelTable {
+  const char *name;
+  bool (*successor)(uint32_t *idx, uint32_t m, uint32_t n);
+  void (*unrank)(uint64_t rank, uint64_t count,
+                 uint32_t n, uint32_t m, uint32_t *idx);
+  uint64_t (*toMask)(const uint32_t *idx, uint32_t m);
+  uint32_t (*fromMask)(uint64_t mask, uint32_t *idx);
+  size_t (*batch)(uint32_t *idx, uint32_t m, uint32_t n,
+                  uint32_t *out, size_t maxCnt);
+  uint64_t (*deposit)(uint64_t value, uint64_t mask);
+  uint64_t (*extract)(uint64_t value, uint64_t mask);
+  size_t (*maskBatch)(uint64_t *compact, uint64_t mask,
+                      uint64_t *out, size_t maxCnt);
+  size_t (*fromMasks)(const uint64_t *masks, size_t cnt, uint32_t *out);
+}; // KernelTable
+
+constexpr size_t FROM_MASKS_SLACK = 16;
+// Masks with at most this many bits are decoded by the tzcnt loop,
+// which is faster for them than vectors. The byte table of the bmi2
+// variant only pays off for denser masks.
+constexpr int FROM_MASKS_SPARSE = 4;
+constexpr int FROM_MASKS_TABLE_SPARSE = 12;
+
+
+namespace detail {
+
+//      Function : successor
+//      Abstract : Find the rightmost index that can still move,
+//      increment it and reset the ones after it to follow it.
+COMBINATIONS_ALWAYS_INLINE bool
+successor(uint32_t *idx, const uint32_t m, const uint32_t n)
+{
+  uint32_t i = m;
+  while (i > 0 && idx[i-1] == n - m + i - 1) {
+    --i;
+  } // while
+  if (i == 0) {
+    return false;
+  } // if
+  uint32_t next = ++idx[i-1];
+  for (uint32_t j = i; j < m; ++j) {
+    idx[j] = ++next;
+  } // for
+  return true;
+} // successor
+
+
+//      Function : unrank
+//      Abstract : Walk the elements in order, keeping c = C(n', m')
+//      for the remaining n' elements and m' positions. Of those,
+//      C(n'-1, m'-1) = c*m'/n' start with the current element.
+COMBINATIONS_ALWAYS_INLINE void
+unrank(uint64_t rank, uint64_t c,
+       const uint32_t n, uint32_t m, uint32_t *idx)
+{
+  for (uint32_t el = 0, rest = n; m > 0; ++el, --rest) {
+    uint64_t with;
+    if (c <= UINT64_MAX / m) {
+      with = c * m / rest;
+    } else {
+#ifdef __SIZEOF_INT128__
+      with = uint64_t((unsigned __int128)c * m / rest);
+#else
+      with = c / rest * m + c % rest * m / rest;
+#endif
+    } // if
+    if (rank < with) {
+      *idx++ = el;
+      c = with;
+      --m;
+    } else {
+      rank -= with;
+      c -= with;
+    } // if
+  } // for
+} // unrank
+
+
+//      Function : toMask
+//      Abstract : Set one bit per index.
+COMBINATIONS_ALWAYS_INLINE uint64_t
+toMask(const uint32_t *idx, const uint32_t m)
+{
+  uint64_t mask = 0;
+  for (uint32_t i = 0; i < m; ++i) {
+    mask |= uint64_t(1) << idx[i];
+  } // for
+  return mask;
+} // toMask
+
+
+//      Function : fromMask
+//      Abstract : Peel off the lowest set bit until none are left.
+COMBINATIONS_ALWAYS_INLINE uint32_t
+fromMask(uint64_t mask, uint32_t *idx)
+{
+  uint32_t cnt = 0;
+  while (mask) {
+    idx[cnt++] = uint32_t(__builtin_ctzll(mask));
+    mask &= mask - 1;
+  } // while
+  return cnt;
+} // fromMask
+
+
+//      Function : batch
+//      Abstract : Emit successors of idx into a flat buffer.
+COMBINATIONS_ALWAYS_INLINE size_t
+batch(uint32_t *idx, const uint32_t m, const uint32_t n,
+      uint32_t *out, const size_t maxCnt)
+{
+  size_t cnt = 0;
+  while (cnt < maxCnt && successor(idx, m, n)) {
+    for (uint32_t j = 0; j < m; ++j) {
+      out[j] = idx[j];
+    } // for
+    out += m;
+    ++cnt;
+  } // while
+  return cnt;
+} // batch
+
+
+//      Function : deposit
+//      Abstract : Software PDEP: one branch-free step per set bit of
+//      mask up to the highest bit of value. Builds targeting BMI2 use
+//      the instruction directly.
+COMBINATIONS_ALWAYS_INLINE uint64_t
+deposit(uint64_t value, uint64_t mask)
+{
+#ifdef __BMI2__
+  return _pdep_u64(value, mask);
+#else
+  uint64_t result = 0;
+  for (; value != 0 && mask != 0; value >>= 1) {
+    result |= mask & -mask & -(value & 1);
+    mask &= mask - 1;
+  } // for
+  return result;
+#endif
+} // deposit
+
+
+//      Function : extract
+//      Abstract : Software PEXT, the inverse of deposit on mask.
+COMBINATIONS_ALWAYS_INLINE uint64_t
+extract(const uint64_t value, uint64_t mask)
+{
+#ifdef __BMI2__
+  return _pext_u64(value, mask);
+#else
+  uint64_t result = 0;
+  for (uint32_t i = 0; mask != 0; ++i) {
+    result |= uint64_t((value & mask & -mask) != 0) << i;
+    mask &= mask - 1;
+  } // for
+  return result;
+#endif
+} // extract
+
+
+//      Function : colexSuccessor
+//      Abstract : Gosper's hack: the next larger number with as many
+//      set bits as x, i.e. the colex successor of a subset. Returns
+//      false, leaving x unchanged, if it would exceed limit.
+COMBINATIONS_ALWAYS_INLINE bool
+colexSuccessor(uint64_t &x, const uint64_t limit)
+{
+  uint64_t low = x & -x;
+  uint64_t ripple = x + low;
+  if (ripple == 0) {
+    return false;
+  } // if
+  uint64_t next = (((ripple ^ x) >> 2) >> __builtin_ctzll(low)) | ripple;
+  if (next > limit) {
+    return false;
+  } // if
+  x = next;
+  return true;
+} // colexSuccessor
+
+
+//      Function : maskBatch
+//      Abstract : Emit deposited colex successors of a compact subset.
+//      Deposit is the variant's PDEP.
+template <class Deposit>
+COMBINATIONS_ALWAYS_INLINE size_t
+maskBatch(uint64_t *compact, const uint64_t mask,
+          uint64_t *out, const size_t maxCnt, const Deposit &deposit)
+{
+  uint32_t k = uint32_t(__builtin_popcountll(mask));
+  uint64_t limit = k == 64 ? UINT64_MAX : (uint64_t(1) << k) - 1;
+  uint64_t x = *compact;
+  size_t cnt = 0;
+  while (cnt < maxCnt && colexSuccessor(x, limit)) {
+    out[cnt++] = deposit(x, mask);
+  } // while
+  *compact = x;
+  return cnt;
+} // maskBatch
+
+
+//      Function : fromMasksLoop
+//      Abstract : fromMasks by peeling off the lowest set bit with
+//      tzcnt, one data-dependent branch per index.
+COMBINATIONS_ALWAYS_INLINE size_t
+fromMasksLoop(const uint64_t *masks, const size_t cnt, uint32_t *out)
+{
+  uint32_t *start = out;
+  for (size_t i = 0; i < cnt; ++i) {
+    out += fromMask(masks[i], out);
+  } // for each mask
+  return size_t(out - start);
+} // fromMasksLoop
+
+
+//      Function : byteIndices
+//      Abstract : For each byte value, the positions of its set bits,
+//      padded with zeros to eight.
+constexpr std::array<std::array<uint8_t, 8>, 256>
+byteIndices()
+{
+  std::array<std::array<uint8_t, 8>, 256> table{};
+  for (uint32_t b = 0; b < 256; ++b) {
+    uint32_t cnt = 0;
+    for (uint8_t bit = 0; bit < 8; ++bit) {
+      if (b & (1u << bit)) {
+        table[b][cnt++] = bit;
+      } // if
+    } // for
+  } // for each byte
+  return table;
+} // byteIndices
+
+inline constexpr std::array<std::array<uint8_t, 8>, 256> BYTE_INDICES =
+  byteIndices();
+
+
+//      Function : fromMasksTable
+//      Abstract : fromMasks a byte at a time: copy all eight table
+//      entries of the byte plus its offset and advance by its
+//      popcount. Only zero bytes branch. Needs a popcount instruction
+//      and dense masks to pay off.
+COMBINATIONS_ALWAYS_INLINE size_t
+fromMasksTable(const uint64_t *masks, const size_t cnt, uint32_t *out)
+{
+  uint32_t *start = out;
+  for (size_t i = 0; i < cnt; ++i) {
+    if (__builtin_popcountll(masks[i]) <= FROM_MASKS_TABLE_SPARSE) {
+      out += fromMask(masks[i], out);
+      continue;
+    } // if
+    for (uint64_t mask = masks[i], base = 0; mask != 0;
+         mask >>= 8, base += 8) {
+      uint32_t b = uint32_t(mask & 0xff);
+      if (b == 0) {
+        continue;
+      } // if
+      for (uint32_t j = 0; j < 8; ++j) {
+        out[j] = uint32_t(base) + BYTE_INDICES[b][j];
+      } // for
+      out += __builtin_popcount(b);
+    } // for each byte
+  } // for each mask
+  return size_t(out - start);
+} // fromMasksTable
+
+
+#ifdef COMBINATIONS_X86_DISPATCH
+//      Function : fromMasksAvx2
+//      Abstract : fromMasksTable with each byte's entries widened to
+//      a vector of eight indices, offset and stored at once.
+__attribute__((target("popcnt,avx,avx2"))) inline size_t
+fromMasksAvx2(const uint64_t *masks, const size_t cnt, uint32_t *out)
+{
+  uint32_t *start = out;
+  for (size_t i = 0; i < cnt; ++i) {
+    if (__builtin_popcountll(masks[i]) <= FROM_MASKS_SPARSE) {
+      out += fromMask(masks[i], out);
+      continue;
+    } // if
+    __m256i base = _mm256_setzero_si256();
+    const __m256i eight = _mm256_set1_epi32(8);
+    for (uint64_t mask = masks[i]; mask != 0; mask >>= 8) {
+      uint32_t b = uint32_t(mask & 0xff);
+      __m256i idx = _mm256_cvtepu8_epi32(_mm_loadl_epi64(
+        reinterpret_cast<const __m128i *>(BYTE_INDICES[b].data())));
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(out),
+                          _mm256_add_epi32(idx, base));
+      out += __builtin_popcount(b);
+      base = _mm256_add_epi32(base, eight);
+    } // for each byte
+  } // for each mask
+  return size_t(out - start);
+} // fromMasksAvx2
+
+
+//      Function : fromMasksAvx512
+//      Abstract : fromMasks sixteen bits at a time with VPCOMPRESSD,
+//      which packs the indices of the set bits of a lane mask.
+__attribute__((target("popcnt,avx,avx2,avx512f"))) inline size_t
+fromMasksAvx512(const uint64_t *masks, const size_t cnt, uint32_t *out)
+{
+  uint32_t *start = out;
+  const __m512i iota = _mm512_set_epi32(15, 14, 13, 12, 11, 10, 9, 8,
+                                        7, 6, 5, 4, 3, 2, 1, 0);
+  const __m512i sixteen = _mm512_set1_epi32(16);
+  for (size_t i = 0; i < cnt; ++i) {
+    if (__builtin_popcountll(masks[i]) <= FROM_MASKS_SPARSE) {
+      out += fromMask(masks[i], out);
+      continue;
+    } // if
+    __m512i idx = iota;
+    for (uint64_t mask = masks[i]; mask != 0; mask >>= 16) {
+      __mmask16 lanes = __mmask16(mask & 0xffff);
+      _mm512_storeu_si512(out, _mm512_maskz_compress_epi32(lanes, idx));
+      out += __builtin_popcount(lanes);
+      idx = _mm512_add_epi32(idx, sixteen);
+    } // for each chunk
+  } // for each mask
+  return size_t(out - start);
+} // fromMasksAvx512
+#endif
+
+} // namespace detail
+
+
+// Define the kernels of one variant as out-of-line functions compiled
+// with the given target attribute around the inlined generic bodies.
+// DEPOSIT and EXTRACT are the variant's PDEP and PEXT and FROM_MASKS
+// its fromMasks.
+#define COMBINATIONS_KERNEL_VARIANT(NAME, ATTR, DEPOSIT, EXTRACT,       \
+                                    FROM_MASKS)                         \
+  namespace NAME {                                                      \
+  ATTR inline bool successor(uint32_t *idx, uint32_t m, uint32_t n) {   \
+    return detail::successor(idx, m, n); }                              \
+  ATTR inline void unrank(uint64_t rank, uint64_t count,                \
+                          uint32_t n, uint32_t m, uint32_t *idx) {      \
+    detail::unrank(rank, count, n, m, idx); }                           \
+  ATTR inline uint64_t toMask(const uint32_t *idx, uint32_t m) {        \
+    return detail::toMask(idx, m); }                                    \
+  ATTR inline uint32_t fromMask(uint64_t mask, uint32_t *idx) {         \
+    return detail::fromMask(mask, idx); }                               \
+  ATTR inline size_t batch(uint32_t *idx, uint32_t m, uint32_t n,       \
+                           uint32_t *out, size_t maxCnt) {              \
+    return detail::batch(idx, m, n, out, maxCnt); }                     \
+  ATTR inline uint64_t deposit(uint64_t value, uint64_t mask) {         \
+    return DEPOSIT(value, mask); }                                      \
+  ATTR inline uint64_t extract(uint64_t value, uint64_t mask) {         \
+    return EXTRACT(value, mask); }                                      \
+  struct Deposit {                                                      \
+    ATTR uint64_t                                                       \
+    operator()(uint64_t value, uint64_t mask) const {                   \
+      return DEPOSIT(value, mask); }                                    \
+  };                                                                    \
+  ATTR inline size_t maskBatch(uint64_t *compact, uint64_t mask,        \
+                               uint64_t *out, size_t maxCnt) {          \
+    return detail::maskBatch(compact, mask, out, maxCnt, Deposit()); }  \
+  ATTR inline size_t fromMasks(const uint64_t *masks, size_t cnt,       \
+                               uint32_t *out) {                         \
+    return FROM_MASKS(masks, cnt, out); }                               \
+  inline const KernelTable table = {                                    \
+    #NAME, successor, unrank, toMask, fromMask, batch,                  \
+    deposit, extract, maskBatch, fromMasks };                           \
+  } // namespace NAME
+
+COMBINATIONS_KERNEL_VARIANT(generic, , detail::deposit, detail::extract,
+  detail::fromMasksLoop)
+#ifdef COMBINATIONS_X86_DISPATCH
+COMBINATIONS_KERNEL_VARIANT(bmi2,
+  __attribute__((target("popcnt,lzcnt,bmi,bmi2"))), _pdep_u64, _pext_u64,
+  detail::fromMasksTable)
+COMBINATIONS_KERNEL_VARIANT(avx2,
+  __attribute__((target("popcnt,lzcnt,bmi,bmi2,avx,avx2,fma"))),
+  _pdep_u64, _pext_u64, detail::fromMasksAvx2)
+COMBINATIONS_KERNEL_VARIANT(avx512,
+  __attribute__((target("popcnt,lzcnt,bmi,bmi2,avx,avx2,fma,avx512f"))),
+  _pdep_u64, _pext_u64, detail::fromMasksAvx512)
+#endif
+
+#undef COMBINATIONS_KERNEL_VARIANT
+
+
+//      Function : variants
+//      Abstract : The kernel variants the host can run, best last.
+inline std::vector<const KernelTable *>
+variants()
+{
+  std::vector<const KernelTable *> result{&generic::table};
+#ifdef COMBINATIONS_X86_DISPATCH
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("bmi2") && __builtin_cpu_supports("popcnt")) {
+    result.push_back(&bmi2::table);
+    if (__builtin_cpu_supports("avx2")) {
+      result.push_back(&avx2::table);
+      if (__builtin_cpu_supports("avx512f")) {
+        result.push_back(&avx512::table);
+      } // if
+    } // if
+  } // if
+#endif
+  return result;
+} // variants
+
+
+//      Function : best
+//      Abstract : The best variant for the host, selected once.
+inline const KernelTable &
+best()
+{
+  static const KernelTable *table = variants().back();
+  return *table;
+} // best
+
+} // namespace kernels
+} // namespace combinations
+
+#endif // KERNELS_H
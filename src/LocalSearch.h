@@ -0,0 +1,219 @@
+//
+//      File     : LocalSearch.h
+//      Abstract : The swap neighbourhood of a combination, i.e. the
+//      m*(n-m) combinations obtained by replacing one chosen index by
+//      one unchosen index, with the lexicographic rank of each, and a
+//      local search driver that moves through it. A combination is an
+//      ascending array of m indices into {0,...,n-1}.
+//
+
+#ifndef LOCALSEARCH_H
+#define LOCALSEARCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "TraceScope.h"
+
+namespace combinations {
+
+//      Struct   : Swap
+//      Abstract : A neighbour: the index out leaves the combination,
+//      the index in joins it and rank is the lexicographic rank of
+//      the result among all m-subsets.
+struct Swap {
+  uint32_t out;
+  uint32_t in;
+  uint64_t rank;
+}; // Swap
+
+
+//      Class    : SwapNeighborhood
+//      Abstract : Enumerates swap neighbours for fixed n and m. The
+//      rank of a combination c is C(n, m) - 1 - sum_p T(c[p], p) with
+//      T(v, p) = C(n-1-v, m-p). A swap shifts the chosen indices
+//      between the old and new position by one place, so prefix sums
+//      of the resulting changes of T give each neighbour's rank in
+//      O(1). The binomial table and the scratch arrays are allocated
+//      by the constructor; enumeration allocates nothing. Ranks are
+//      computed modulo 2^64 and are exact whenever C(n, m) fits.
+class SwapNeighborhood {
+public:
+  SwapNeighborhood(uint32_t n, uint32_t m); // CTOR
+  ~SwapNeighborhood() = default; // DTOR
+
+  uint32_t n() const { return _n; };
+  uint32_t m() const { return _m; };
+  uint64_t rank(const uint32_t *idx) const;
+  void apply(uint32_t *idx, const Swap &swap) const;
+
+  // Call fn(swap) for each neighbour of idx. If fn returns bool,
+  // returning false stops the enumeration.
+  template <class Fn>
+  void forEach(const uint32_t *idx, Fn fn);
+
+  SwapNeighborhood(const SwapNeighborhood &) = delete; // Copy CTOR
+  SwapNeighborhood &operator=(const SwapNeighborhood &) =
+    delete; // Copy assignment
+  SwapNeighborhood(SwapNeighborhood &&) = delete; // Move CTOR
+  SwapNeighborhood &operator=(SwapNeighborhood &&) =
+    delete; // Move assignment
+private:
+  uint64_t choose(uint32_t a, uint32_t b) const {
+    return _binomials[size_t(a) * (_m + 1) + b]; };
+  uint64_t term(uint32_t v, uint32_t pos) const {
+    return choose(_n - 1 - v, _m - pos); };
+
+  uint32_t _n;
+  uint32_t _m;
+  uint64_t _total; // C(n, m)
+  std::vector<uint64_t> _binomials; // C(a, b) for a <= n, b <= m.
+  std::vector<uint64_t> _right; // Prefix sums of T(c[i], i+1) - T(c[i], i).
+  std::vector<uint64_t> _left; // Prefix sums of T(c[i], i-1) - T(c[i], i).
+}; // SwapNeighborhood
+
+
+//      Function : SwapNeighborhood::SwapNeighborhood
+//      Abstract : Build Pascal's triangle up to n over m columns.
+inline
+SwapNeighborhood::SwapNeighborhood(const uint32_t n, const uint32_t m) :
+  _n(n), _m(m), _binomials(size_t(n + 1) * (m + 1), 0),
+  _right(m + 1, 0), _left(m + 1, 0)
+{
+  if (m > n) {
+    throw std::invalid_argument("Subset size exceeds set size.");
+  } // if
+  for (uint32_t a = 0; a <= n; ++a) {
+    _binomials[size_t(a) * (m + 1)] = 1;
+    for (uint32_t b = 1; b <= m && b <= a; ++b) {
+      _binomials[size_t(a) * (m + 1) + b] =
+        choose(a - 1, b - 1) + (b < a ? choose(a - 1, b) : 0);
+    } // for
+  } // for
+  _total = choose(n, m);
+} // SwapNeighborhood::SwapNeighborhood
+
+
+//      Function : SwapNeighborhood::rank
+//      Abstract : Lexicographic rank of a combination in O(m).
+inline uint64_t
+SwapNeighborhood::rank(const uint32_t *idx) const
+{
+  uint64_t result = _total - 1;
+  for (uint32_t p = 0; p < _m; ++p) {
+    result -= term(idx[p], p);
+  } // for
+  return result;
+} // SwapNeighborhood::rank
+
+
+//      Function : SwapNeighborhood::apply
+//      Abstract : Replace swap.out by swap.in, keeping idx ascending.
+inline void
+SwapNeighborhood::apply(uint32_t *idx, const Swap &swap) const
+{
+  uint32_t p = 0;
+  while (idx[p] != swap.out) {
+    ++p;
+  } // while
+  while (p > 0 && idx[p-1] > swap.in) {
+    idx[p] = idx[p-1];
+    --p;
+  } // while
+  while (p+1 < _m && idx[p+1] < swap.in) {
+    idx[p] = idx[p+1];
+    ++p;
+  } // while
+  idx[p] = swap.in;
+} // SwapNeighborhood::apply
+
+
+//      Function : SwapNeighborhood::forEach
+//      Abstract : For each chosen position p and each unchosen index
+//      x in ascending order, x lands at position q among the others.
+//      If x < c[p] the indices at [q, p) move one place right;
+//      otherwise those at (p, q] move one place left.
+template <class Fn>
+void
+SwapNeighborhood::forEach(const uint32_t *idx, Fn fn)
+{
+  uint64_t base = 0;
+  for (uint32_t i = 0; i < _m; ++i) {
+    uint64_t t = term(idx[i], i);
+    base += t;
+    _right[i+1] = _right[i] + (i+1 < _m ? term(idx[i], i+1) - t : 0);
+    _left[i+1] = _left[i] + (i > 0 ? term(idx[i], i-1) - t : 0);
+  } // for
+
+  for (uint32_t p = 0; p < _m; ++p) {
+    uint64_t without = _total - 1 - base + term(idx[p], p);
+    uint32_t q = 0; // Chosen indices other than c[p] below x.
+    for (uint32_t x = 0; x < _n; ++x) {
+      if (x == idx[p]) {
+        continue;
+      } // if
+      uint32_t next = q + (q >= p); // Position of the next other one.
+      if (next < _m && idx[next] == x) {
+        ++q;
+        continue;
+      } // if
+      uint64_t shift = x < idx[p] ? _right[p] - _right[q]
+                                  : _left[q+1] - _left[p+1];
+      Swap swap{idx[p], x, without - term(x, q) - shift};
+      if constexpr (std::is_same_v<decltype(fn(swap)), bool>) {
+        if (! fn(swap)) {
+          return;
+        } // if
+      } else {
+        fn(swap);
+      } // if
+    } // for each index
+  } // for each position
+} // SwapNeighborhood::forEach
+
+
+//      Function : localSearch
+//      Abstract : Steepest descent over swap neighbourhoods. delta(swap)
+//      returns the change of the objective caused by a swap, usually
+//      computed incrementally from state the caller keeps; commit(swap)
+//      is called after each move so the caller can update that state.
+//      With firstImprovement the first improving swap is taken rather
+//      than the best. Stops at a local minimum or after maxMoves
+//      moves, which are returned.
+template <class Delta, class Commit>
+size_t
+localSearch(SwapNeighborhood &hood, uint32_t *idx, Delta delta,
+            Commit commit, size_t maxMoves = SIZE_MAX,
+            bool firstImprovement = false)
+{
+  COMBINATIONS_TRACE_SCOPE("localSearch");
+  size_t moves = 0;
+  while (moves < maxMoves) {
+    bool found = false;
+    Swap best{};
+    decltype(delta(best)) bestDelta{};
+    hood.forEach(idx, [&](const Swap &swap) {
+      auto change = delta(swap);
+      if (change < bestDelta) {
+        best = swap;
+        bestDelta = change;
+        found = true;
+      } // if
+      return ! (found && firstImprovement);
+    });
+    if (! found) {
+      break;
+    } // if
+    hood.apply(idx, best);
+    commit(best);
+    ++moves;
+  } // while
+  return moves;
+} // localSearch
+
+} // namespace combinations
+
+#endif // LOCALSEARCH_H
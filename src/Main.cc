@@ -3,11 +3,24 @@
 //      Abstract : Test bench.
 //
 
+#include "AllocStats.h"
 #include "Args.h"
 
+#include <Aggregates.h>
 #include <Combinations.h>
+#include <Constrained.h>
+#include <HugePages.h>
+#include <Kernels.h>
+#include <LocalSearch.h>
+#include <Masks.h>
+#include <SubsetSum.h>
+#include <Tiles.h>
+#include <Trace.h>
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <memory_resource>
 #include <numeric>
 #include <string>
 
@@ -16,6 +29,12 @@
   << ": " << #expr \
   << std::endl;
 
+// Per-operation allocation tallies, filled in when built with
+// ALLOC_STATS (make alloc).
+static alloc::Tally nextTally;
+static alloc::Tally getTally;
+static alloc::Tally generateTally;
+
 //      Struct   : CombinationsArgs
 //      Abstract :
 struct CombinationsArgs : public argparse::Args {
@@ -27,6 +46,9 @@ struct CombinationsArgs : public argparse::Args {
     set_default(1<<27);
   bool &enumerate = flag("e,enumerate", "use enumerator instead of generator.");
   bool &printp = flag("p,print", "print the combinations.");
+  std::string &trace = kwarg("t,trace",
+                             "write a Chrome trace to this file.").
+    set_default("");
 
   void prolog() override {
     std::cout << "Test combination classes." << std::endl;
@@ -39,6 +61,7 @@ struct CombinationsArgs : public argparse::Args {
 size_t
 testEnumerate(size_t n, size_t m, bool printp)
 {
+  COMBINATIONS_TRACE_SCOPE("testEnumerate");
   std::vector<int> set;
   set.resize(n, 0);
   std::iota(set.begin(), set.end(), 0);
@@ -46,10 +69,18 @@ testEnumerate(size_t n, size_t m, bool printp)
   size_t cnt2 = 0;
 
   combinations::Lexor<int> lexi(set, m);
+  auto next = [&]() {
+    alloc::Scope scope(nextTally);
+    return enumerator.next();
+  };
+  auto get = [&](size_t i) {
+    alloc::Scope scope(getTally);
+    return lexi.get(i);
+  };
   for (auto comb = enumerator.first(m);
        comb.size();
-       comb = enumerator.next()) {
-    auto comb2 = lexi.get(cnt2);
+       comb = next()) {
+    auto comb2 = get(cnt2);
     if (comb != comb2) {
       std::cout << "Combination "
                 << cnt2
@@ -58,6 +89,7 @@ testEnumerate(size_t n, size_t m, bool printp)
       break;
     } // if
     if (printp) {
+      COMBINATIONS_TRACE_SCOPE("output");
       for (auto elem : comb) {
         std::cout << elem << " ";
       } // for each element
@@ -70,18 +102,45 @@ testEnumerate(size_t n, size_t m, bool printp)
 } // testEnumerate
 
 
+//      Function : testLargeUniverse
+//      Abstract : Restart an Enumerator for pairs of a large set many
+//      times. Its state is O(m), so each restart must not touch the
+//      whole set; the check is that the first pairs are right.
+bool
+testLargeUniverse()
+{
+  std::vector<int> set(1 << 22);
+  std::iota(set.begin(), set.end(), 0);
+  combinations::Enumerator<int> enumerator(set);
+  for (int restart = 0; restart < 10000; ++restart) {
+    auto comb = enumerator.first(2);
+    for (int j = 1; j <= 3; ++j, comb = enumerator.next()) {
+      if (comb != std::vector<int>{0, j}) {
+        return false;
+      } // if
+    } // for
+  } // for each restart
+  return true;
+} // testLargeUniverse
+
+
 //      Function : testGenerate
 //      Abstract :
 size_t
 testGenerate(size_t n, size_t m, bool printp)
 {
+  COMBINATIONS_TRACE_SCOPE("testGenerate");
   std::vector<int> set;
   set.resize(n, 0);
   std::iota(set.begin(), set.end(), 0);
   combinations::Generator<int> generator(set);
-  generator.generate(m);
+  {
+    alloc::Scope scope(generateTally);
+    generator.generate(m);
+  }
 
   if (printp) {
+    COMBINATIONS_TRACE_SCOPE("output");
     for (auto comb : generator) {
       for (auto elem : comb) {
         std::cout << elem << " ";
@@ -94,6 +153,913 @@ testGenerate(size_t n, size_t m, bool printp)
 } // testGenerate
 
 
+//      Function : testFixed
+//      Abstract : Check FixedEnumerator against Enumerator. Returns the
+//      number of matching combinations, or zero on a mismatch.
+template <size_t M>
+size_t
+testFixed(size_t n)
+{
+  std::vector<int> set(n);
+  std::iota(set.begin(), set.end(), 0);
+  combinations::Enumerator<int> enumerator(set);
+  combinations::FixedEnumerator<int, M> fixed(set);
+  size_t cnt = 0;
+
+  bool more = fixed.first();
+  for (auto comb = enumerator.first(M);
+       comb.size();
+       comb = enumerator.next()) {
+    auto fixedComb = fixed.get();
+    if (! more || ! std::equal(comb.begin(), comb.end(), fixedComb.begin())) {
+      std::cout << "Fixed combination " << cnt << " doesn't match."
+                << std::endl;
+      return 0;
+    } // if
+    ++cnt;
+    more = fixed.next();
+  } // for
+
+  return more ? 0 : cnt;
+} // testFixed
+
+
+//      Function : testFixed
+//      Abstract : Dispatch to the FixedEnumerator for m, if any.
+size_t
+testFixed(size_t n, size_t m)
+{
+  switch (m) {
+  case 1: return testFixed<1>(n);
+  case 2: return testFixed<2>(n);
+  case 3: return testFixed<3>(n);
+  case 4: return testFixed<4>(n);
+  case 5: return testFixed<5>(n);
+  case 6: return testFixed<6>(n);
+  case 7: return testFixed<7>(n);
+  case 8: return testFixed<8>(n);
+  default: return 0;
+  } // switch
+} // testFixed
+
+
+// Compile-time tables must follow the library's order.
+constexpr auto table83 = combinations::combinationTable<8, 3>();
+static_assert(table83.size() == combinations::binomial(8, 3));
+static_assert(table83[17] == combinations::unrank<3>(17, 8));
+static_assert(combinations::rank(table83[41], 8) == 41);
+static_assert(combinations::binomial(67, 33) == 14226520737620288370ull);
+
+// The free successor and predecessor agree with the table.
+constexpr bool
+stepsMatchTable()
+{
+  std::array<uint32_t, 3> comb = table83.front();
+  for (size_t i = 1; i < table83.size(); ++i) {
+    if (! combinations::next_combination(comb.begin(), comb.end(), 8u) ||
+        comb != table83[i]) {
+      return false;
+    } // if
+  } // for
+  if (combinations::next_combination(comb.begin(), comb.end(), 8u) ||
+      comb != table83.front() ||
+      combinations::prev_combination(comb.begin(), comb.end(), 8u)) {
+    return false;
+  } // if
+  for (size_t i = table83.size() - 1; i > 0; --i) {
+    if (comb != table83[i] ||
+        ! combinations::prev_combination(comb.begin(), comb.end(), 8u)) {
+      return false;
+    } // if
+  } // for
+  return comb == table83.front();
+} // stepsMatchTable
+static_assert(stepsMatchTable());
+
+
+//      Function : testTable
+//      Abstract : Check a compile-time table against Lexor.
+bool
+testTable()
+{
+  std::vector<int> set(8);
+  std::iota(set.begin(), set.end(), 0);
+  combinations::Lexor<int> lexi(set, 3);
+  for (size_t i = 0; i < table83.size(); ++i) {
+    auto comb = lexi.get(i);
+    if (! std::equal(comb.begin(), comb.end(), table83[i].begin())) {
+      return false;
+    } // if
+  } // for
+  return true;
+} // testTable
+
+
+//      Function : testNextPrev
+//      Abstract : Step a plain index vector forward with
+//      next_combination and back with prev_combination, checking
+//      against Lexor. Returns the number of combinations.
+size_t
+testNextPrev(size_t n, size_t m)
+{
+  if (m > n) {
+    return 0;
+  } // if
+  std::vector<int> set(n);
+  std::iota(set.begin(), set.end(), 0);
+  combinations::Lexor<int> lexi(set, m);
+  std::vector<int> comb(set.begin(), set.begin() + m);
+  size_t cnt = 0;
+  do {
+    if (comb != lexi.get(cnt++)) {
+      return 0;
+    } // if
+  } while (combinations::next_combination(comb.begin(), comb.end(), int(n)));
+
+  // Back at the first combination, the predecessor wraps to the last.
+  if (combinations::prev_combination(comb.begin(), comb.end(), int(n))) {
+    return 0;
+  } // if
+  size_t back = cnt;
+  do {
+    if (comb != lexi.get(--back)) {
+      return 0;
+    } // if
+  } while (combinations::prev_combination(comb.begin(), comb.end(), int(n)));
+  return back == 0 ? cnt : 0;
+} // testNextPrev
+
+
+//      Function : testPrefixRange
+//      Abstract : Walk an Enumerator, skipping the rest of the
+//      current prefix at every third step, and check that the ranks
+//      accounted for with Lexor::prefixRange track the combinations.
+//      Returns the number of combinations accounted for.
+size_t
+testPrefixRange(size_t n, size_t m)
+{
+  std::vector<int> set(n);
+  std::iota(set.begin(), set.end(), 0);
+  combinations::Enumerator<int> enumerator(set);
+  combinations::Lexor<int> lexi(set, m);
+  size_t rank = 0;
+  size_t step = 0;
+  for (auto comb = enumerator.first(m); comb.size(); ++step) {
+    if (comb != lexi.get(rank)) {
+      return 0;
+    } // if
+    size_t k = step % (m + 1);
+    const auto &idx = enumerator.indices();
+    auto [begin, end] =
+      lexi.prefixRange(std::vector<size_t>(idx.begin(), idx.begin() + k));
+    if (rank < begin || rank >= end) {
+      return 0;
+    } // if
+    if (step % 3 == 0) {
+      comb = enumerator.skip(k);
+      rank = end;
+    } else {
+      comb = enumerator.next();
+      ++rank;
+    } // if
+  } // for
+  return m == 0 ? 1 : rank;
+} // testPrefixRange
+
+
+//      Function : testBestFirst
+//      Abstract : Enumerate all combinations best first with repeated
+//      integer weights, so ties occur and sums are exact. Check that
+//      the weights are right and nondecreasing and that every
+//      combination appears exactly once. Returns the number of
+//      combinations, or 0 on a mismatch.
+size_t
+testBestFirst(size_t n, size_t m)
+{
+  std::vector<int> set(n);
+  std::iota(set.begin(), set.end(), 0);
+  std::vector<double> weights(n);
+  for (size_t i = 0; i < n; ++i) {
+    weights[i] = double((i * 7919) % 13);
+  } // for
+  combinations::BestFirstEnumerator<int> best(set, weights);
+  std::vector<std::vector<int>> seen;
+  double last = 0.0;
+  for (auto comb = best.first(m); comb.size(); comb = best.next()) {
+    double weight = 0.0;
+    for (int elem : comb) {
+      weight += weights[elem];
+    } // for each element
+    if (weight != best.weight() || weight < last ||
+        ! std::is_sorted(comb.begin(), comb.end())) {
+      std::cout << "Best-first combination " << seen.size()
+                << " is out of order." << std::endl;
+      return 0;
+    } // if
+    last = weight;
+    seen.push_back(comb);
+  } // for
+
+  std::sort(seen.begin(), seen.end());
+  combinations::Lexor<int> lexi(set, m);
+  for (size_t i = 0; i < seen.size(); ++i) {
+    if (seen[i] != lexi.get(i)) {
+      std::cout << "Best-first combination " << i << " is missing."
+                << std::endl;
+      return 0;
+    } // if
+  } // for
+  return m == 0 ? 1 : seen.size();
+} // testBestFirst
+
+
+//      Function : testSubsetSum
+//      Abstract : Search every possible sum with the meet-in-the-middle
+//      engine. Every match must build a combination with that sum,
+//      and over all sums each combination must be found once, so the
+//      number of matches is the number of combinations.
+size_t
+testSubsetSum(size_t n, size_t m)
+{
+  std::vector<int64_t> weights(n);
+  for (size_t i = 0; i < n; ++i) {
+    weights[i] = int64_t((i * 37) % 11) - 3;
+  } // for
+  combinations::SubsetSum<int64_t> search(weights);
+  std::vector<std::vector<size_t>> found;
+  int64_t low = -3 * int64_t(m);
+  int64_t high = 7 * int64_t(m);
+  for (int64_t target = low; target <= high; ++target) {
+    bool ok = true;
+    search.find(m, target, 0, [&](const auto &match) {
+      auto comb = search.combination(match, m);
+      int64_t sum = 0;
+      for (size_t i : comb) {
+        sum += weights[i];
+      } // for each index
+      ok = ok && sum == target && match.sum == target;
+      found.push_back(comb);
+    });
+    if (! ok) {
+      std::cout << "Subset sum " << target << " doesn't match." << std::endl;
+      return 0;
+    } // if
+  } // for each target
+  std::sort(found.begin(), found.end());
+  if (std::adjacent_find(found.begin(), found.end()) != found.end()) {
+    std::cout << "Subset sum found a combination twice." << std::endl;
+    return 0;
+  } // if
+
+  // A tolerance covering all sums finds everything at once.
+  size_t all = search.find(m, (low + high) / 2, (high - low) / 2 + 1,
+                           [](const auto &) {});
+  return all == found.size() ? found.size() : 0;
+} // testSubsetSum
+
+
+//      Function : testAggregates
+//      Abstract : Compare the closed-form aggregates with sums over all
+//      combinations visited by next_combination.
+bool
+testAggregates(size_t n, size_t m)
+{
+  if (m > n) {
+    return true;
+  } // if
+  std::vector<int64_t> weights(n);
+  for (size_t i = 0; i < n; ++i) {
+    weights[i] = int64_t((i * 37) % 7) - 2;
+  } // for
+  combinations::Aggregates<int64_t> aggregates(weights);
+  std::vector<size_t> idx(m);
+  std::iota(idx.begin(), idx.end(), 0);
+  int64_t products = 0;
+  int64_t sums = 0;
+  double squares = 0.0;
+  size_t cnt = 0;
+  do {
+    int64_t product = 1;
+    int64_t sum = 0;
+    for (size_t i : idx) {
+      product *= weights[i];
+      sum += weights[i];
+    } // for each index
+    products += product;
+    sums += sum;
+    squares += double(sum) * double(sum);
+    ++cnt;
+  } while (combinations::next_combination(idx.begin(), idx.end(), n));
+  double mean = double(sums) / double(cnt);
+  double variance = squares / double(cnt) - mean * mean;
+  // The aggregates keep their own copy of the weights.
+  std::fill(weights.begin(), weights.end(), 0);
+  return products == aggregates.sumOfProducts(m) &&
+    sums == aggregates.sumOfSums(m) &&
+    std::abs(mean - aggregates.mean(m)) < 1e-9 &&
+    std::abs(variance - aggregates.variance(m)) < 1e-6;
+} // testAggregates
+
+
+//      Function : testConstrainedWith
+//      Abstract : Check a constrained counter against the valid
+//      combinations visited by next_combination, in order: count,
+//      unrank and rank of each, and stepping with next.
+template <class Constraint, class Valid>
+bool
+testConstrainedWith(const std::vector<int64_t> &weights, size_t m,
+                    const Constraint &constraint, Valid valid)
+{
+  size_t n = weights.size();
+  combinations::ConstrainedCounter<Constraint> counter(weights, m,
+                                                       constraint);
+  std::vector<std::vector<size_t>> expected;
+  if (m <= n) {
+    std::vector<size_t> idx(m);
+    std::iota(idx.begin(), idx.end(), 0);
+    do {
+      int64_t sum = 0;
+      for (size_t i : idx) {
+        sum += weights[i];
+      } // for each index
+      if (valid(sum)) {
+        expected.push_back(idx);
+      } // if
+    } while (combinations::next_combination(idx.begin(), idx.end(), n));
+  } // if
+  if (counter.count() != expected.size()) {
+    return false;
+  } // if
+  for (uint64_t r = 0; r < expected.size(); ++r) {
+    auto idx = counter.unrank(r);
+    if (idx != expected[r] || counter.rank(idx) != r) {
+      return false;
+    } // if
+  } // for each rank
+  if (expected.empty()) {
+    return true;
+  } // if
+  auto idx = counter.unrank(0);
+  for (size_t r = 1; r < expected.size(); ++r) {
+    if (! counter.next(idx) || idx != expected[r]) {
+      return false;
+    } // if
+  } // for each rank
+  return ! counter.next(idx);
+} // testConstrainedWith
+
+
+//      Function : testInvalidConstraint
+//      Abstract : A constraint without states must be rejected by the
+//      constructor.
+template <class Constraint>
+bool
+testInvalidConstraint(const std::vector<int64_t> &weights, size_t m,
+                      const Constraint &constraint)
+{
+  try {
+    combinations::ConstrainedCounter<Constraint> counter(weights, m,
+                                                         constraint);
+  } catch(std::invalid_argument &) {
+    return true;
+  } // try/catch
+  return false;
+} // testInvalidConstraint
+
+
+//      Function : testConstrained
+//      Abstract : Constrained counting with a weight capacity and with
+//      a residue, and rejection of invalid constraints.
+bool
+testConstrained(size_t n, size_t m)
+{
+  std::vector<int64_t> weights(n);
+  for (size_t i = 0; i < n; ++i) {
+    weights[i] = int64_t((i * 37) % 11);
+  } // for
+  using combinations::constraints::AtMost;
+  using combinations::constraints::Modulo;
+  int64_t capacity = int64_t(4 * m);
+  return
+    testConstrainedWith(weights, m, AtMost{capacity},
+                        [&](int64_t sum) { return sum <= capacity; }) &&
+    testConstrainedWith(weights, m, Modulo{3, 1},
+                        [](int64_t sum) { return sum % 3 == 1; }) &&
+    testInvalidConstraint(weights, m, AtMost{-1}) &&
+    testInvalidConstraint(weights, m, AtMost{-7}) &&
+    testInvalidConstraint(weights, m, Modulo{0, 1}) &&
+    testInvalidConstraint(weights, m, Modulo{-3, 1});
+} // testConstrained
+
+
+//      Function : testMasks
+//      Abstract : Enumerate the m-subsets of a mask with n spread bits
+//      with every kernel variant, one at a time and in batches. Both
+//      must give the subsets of the bit positions in increasing
+//      numeric order, ranked by their place in it.
+bool
+testMasks(size_t n, size_t m)
+{
+  if (n > 64 || m > n) {
+    return true;
+  } // if
+  std::vector<uint32_t> bits(n);
+  uint64_t mask = 0;
+  for (size_t i = 0; i < n; ++i) {
+    bits[i] = uint32_t((i * 5) % 64);
+    mask |= uint64_t(1) << bits[i];
+  } // for
+  std::sort(bits.begin(), bits.end());
+  std::vector<uint64_t> expected;
+  std::vector<size_t> idx(m);
+  std::iota(idx.begin(), idx.end(), 0);
+  do {
+    uint64_t subset = 0;
+    for (size_t i : idx) {
+      subset |= uint64_t(1) << bits[i];
+    } // for each index
+    expected.push_back(subset);
+  } while (combinations::next_combination(idx.begin(), idx.end(), n));
+  std::sort(expected.begin(), expected.end());
+
+  for (auto kernels : combinations::kernels::variants()) {
+    combinations::MaskEnumerator masks(mask, uint32_t(m), *kernels);
+    std::vector<uint64_t> single{masks.first()};
+    for (uint64_t subset; masks.next(subset);) {
+      single.push_back(subset);
+    } // for
+    std::vector<uint64_t> batched{masks.first()};
+    uint64_t buf[7];
+    while (size_t got = masks.batch(buf, 7)) {
+      batched.insert(batched.end(), buf, buf + got);
+    } // while
+    if (single != expected || batched != expected ||
+        masks.count() != expected.size()) {
+      std::cout << "Mask subsets differ for " << kernels->name << std::endl;
+      return false;
+    } // if
+    for (uint64_t r = 0; r < expected.size(); ++r) {
+      if (masks.rank(expected[r]) != r || masks.unrank(r) != expected[r]) {
+        std::cout << "Mask rank differs for " << kernels->name << std::endl;
+        return false;
+      } // if
+    } // for each rank
+    for (uint64_t value : {uint64_t(0), ~uint64_t(0), expected.back(),
+                           uint64_t(0x123456789abcdef)}) {
+      if (kernels->deposit(value, mask) !=
+          combinations::kernels::detail::deposit(value, mask) ||
+          kernels->extract(value, mask) !=
+          combinations::kernels::detail::extract(value, mask)) {
+        std::cout << "PDEP/PEXT differ for " << kernels->name << std::endl;
+        return false;
+      } // if
+    } // for each value
+  } // for each variant
+  return true;
+} // testMasks
+
+
+//      Function : testSwaps
+//      Abstract : Check the swap neighbourhoods of a few combinations:
+//      m*(n-m) distinct neighbours whose ranks unrank, with Lexor, to
+//      the swapped combination. Then minimize a weight sum by local
+//      search, which must reach the m lightest elements.
+bool
+testSwaps(size_t n, size_t m)
+{
+  if (m == 0 || m >= n) {
+    return true;
+  } // if
+  std::vector<int> set(n);
+  std::iota(set.begin(), set.end(), 0);
+  combinations::Lexor<int> lexi(set, m);
+  combinations::SwapNeighborhood hood(n, m);
+  size_t total = combinations::Counter().count(n, m);
+  for (size_t r : {size_t(0), total / 3, total - 1}) {
+    auto comb = lexi.get(r);
+    std::vector<uint32_t> idx(comb.begin(), comb.end());
+    if (hood.rank(idx.data()) != r) {
+      return false;
+    } // if
+    std::vector<uint64_t> ranks;
+    bool ok = true;
+    hood.forEach(idx.data(), [&](const combinations::Swap &swap) {
+      std::vector<uint32_t> moved(idx);
+      hood.apply(moved.data(), swap);
+      auto expected = lexi.get(swap.rank);
+      ok = ok && std::equal(moved.begin(), moved.end(),
+                            expected.begin(), expected.end());
+      ranks.push_back(swap.rank);
+    });
+    std::sort(ranks.begin(), ranks.end());
+    if (! ok || ranks.size() != m * (n - m) ||
+        std::adjacent_find(ranks.begin(), ranks.end()) != ranks.end()) {
+      return false;
+    } // if
+  } // for each start
+
+  std::vector<double> weights(n);
+  for (size_t i = 0; i < n; ++i) {
+    weights[i] = double((i * 7919) % 101);
+  } // for
+  auto start = lexi.get(total / 2);
+  std::vector<uint32_t> idx(start.begin(), start.end());
+  double sum = 0.0;
+  for (uint32_t i : idx) {
+    sum += weights[i];
+  } // for each index
+  for (bool first : {false, true}) {
+    combinations::localSearch(
+      hood, idx.data(),
+      [&](const combinations::Swap &swap) {
+        return weights[swap.in] - weights[swap.out]; },
+      [&](const combinations::Swap &swap) {
+        sum += weights[swap.in] - weights[swap.out]; },
+      SIZE_MAX, first);
+  } // for each strategy
+  std::vector<double> sorted(weights);
+  std::sort(sorted.begin(), sorted.end());
+  return sum == std::accumulate(sorted.begin(), sorted.begin() + m, 0.0);
+} // testSwaps
+
+
+//      Function : testCombination
+//      Abstract : Check Lexor and Generator with the small-buffer
+//      Combination type against the std::vector versions. Four inline
+//      elements make combinations with m > 4 spill to the heap.
+size_t
+testCombination(size_t n, size_t m)
+{
+  using Comb = combinations::Combination<int, 4>;
+  static_assert(std::is_nothrow_move_assignable_v<Comb>);
+  std::vector<int> set(n);
+  std::iota(set.begin(), set.end(), 0);
+  combinations::Lexor<int> lexi(set, m);
+  combinations::Lexor<int, Comb> lexiComb(set, m);
+  combinations::Generator<int, Comb> generator(set);
+  generator.generate(m);
+
+  size_t cnt = 0;
+  for (auto &comb : generator) {
+    auto expected = lexi.get(cnt);
+    Comb copy(comb), moved(lexiComb.get(cnt));
+    Comb assigned = std::move(copy);
+    if (! std::equal(comb.begin(), comb.end(),
+                     expected.begin(), expected.end()) ||
+        moved != comb || assigned != comb || ! copy.empty()) {
+      std::cout << "Combination " << cnt << " doesn't match." << std::endl;
+      return 0;
+    } // if
+    ++cnt;
+  } // for each combination
+
+  return cnt;
+} // testCombination
+
+
+//      Function : testArena
+//      Abstract : Check the pmr variants allocating from a monotonic
+//      arena against the std::allocator versions. The arena outlives
+//      the containers and frees its memory in one step at the end.
+size_t
+testArena(size_t n, size_t m)
+{
+  using Comb = combinations::pmr::Combination<int, 4>;
+  std::pmr::monotonic_buffer_resource arena;
+  std::vector<int> set(n);
+  std::iota(set.begin(), set.end(), 0);
+  std::pmr::vector<int> arenaSet(set.begin(), set.end(), &arena);
+  combinations::Lexor<int> lexi(set, m);
+  combinations::pmr::Lexor<int> arenaLexi(arenaSet, m, &arena);
+  combinations::pmr::Enumerator<int> enumerator(arenaSet, &arena);
+  combinations::pmr::Generator<int, Comb> generator(arenaSet, &arena);
+  generator.generate(m);
+
+  size_t cnt = 0;
+  auto comb = enumerator.first(m);
+  for (auto &arenaComb : generator) {
+    auto expected = lexi.get(cnt);
+    auto got = arenaLexi.get(cnt);
+    if (! std::equal(arenaComb.begin(), arenaComb.end(),
+                     expected.begin(), expected.end()) ||
+        ! std::equal(got.begin(), got.end(),
+                     expected.begin(), expected.end()) ||
+        ! std::equal(comb.begin(), comb.end(),
+                     expected.begin(), expected.end()) ||
+        arenaComb.get_allocator().resource() != &arena) {
+      std::cout << "Arena combination " << cnt << " doesn't match."
+                << std::endl;
+      return 0;
+    } // if
+    comb = enumerator.next();
+    ++cnt;
+  } // for each combination
+
+  // Moving to another resource allocates there, so it can throw.
+  static_assert(! std::is_nothrow_move_assignable_v<Comb>);
+  Comb spilled({1, 2, 3, 4, 5}, &arena);
+  Comb exhausted(std::pmr::null_memory_resource());
+  try {
+    exhausted = std::move(spilled);
+    return 0;
+  } catch(std::bad_alloc &) {
+  } // try/catch
+
+  return cnt;
+} // testArena
+
+
+//      Function : testTrie
+//      Abstract : Check a TrieGenerator against Generator by rank and
+//      in order, also with pmr combinations in an arena. Returns the
+//      number of combinations, or zero on a mismatch.
+size_t
+testTrie(size_t n, size_t m)
+{
+  std::vector<int> set(n);
+  std::iota(set.begin(), set.end(), 0);
+  combinations::Generator<int> generator(set);
+  combinations::TrieGenerator<int> trie(set);
+  generator.generate(m);
+  trie.generate(m);
+  std::pmr::monotonic_buffer_resource arena;
+  std::pmr::vector<int> arenaSet(set.begin(), set.end(), &arena);
+  combinations::pmr::TrieGenerator<int, combinations::pmr::Combination<int>>
+    arenaTrie(arenaSet, &arena);
+  arenaTrie.generate(m);
+  if (trie.size() != generator.size() || arenaTrie.size() != trie.size()) {
+    return 0;
+  } // if
+
+  auto &combs = generator.getCombinations();
+  std::vector<uint32_t> idx(m);
+  size_t cnt = 0;
+  bool ok = true;
+  trie.forEach([&](const std::vector<int> &comb) {
+    ok = ok && comb == combs[cnt] && trie.get(cnt) == combs[cnt];
+    if (m > 0) {
+      trie.indices(cnt, idx.data());
+      ok = ok && std::equal(idx.begin(), idx.end(), comb.begin());
+    } // if
+    ++cnt;
+  });
+  size_t arenaCnt = 0;
+  arenaTrie.forEach([&](const auto &comb) {
+    auto got = arenaTrie.get(arenaCnt);
+    ok = ok && std::equal(comb.begin(), comb.end(), combs[arenaCnt].begin(),
+                          combs[arenaCnt].end()) &&
+      std::equal(got.begin(), got.end(), comb.begin(), comb.end());
+    ++arenaCnt;
+  });
+  if (! ok || cnt != combs.size() || arenaCnt != cnt ||
+      ! trie.get(cnt).empty()) {
+    std::cout << "Trie combinations don't match." << std::endl;
+    return 0;
+  } // if
+  return cnt;
+} // testTrie
+
+
+//      Function : testHugePages
+//      Abstract : Check a Generator and Lexor allocating from an
+//      arena over the huge page resource against Lexor. A small
+//      threshold makes most arena chunks mapped whatever backing the
+//      host grants. All mappings must be gone once the arena is.
+size_t
+testHugePages(size_t n, size_t m)
+{
+  using combinations::huge::Backing;
+  combinations::huge::Resource huge(Backing::HUGE_2M, 4096);
+  std::vector<int> set(n);
+  std::iota(set.begin(), set.end(), 0);
+  combinations::Lexor<int> lexi(set, m);
+  size_t cnt = 0;
+  {
+    std::pmr::monotonic_buffer_resource arena(&huge);
+    std::pmr::vector<int> arenaSet(set.begin(), set.end(), &arena);
+    combinations::pmr::Lexor<int> arenaLexi(arenaSet, m, &arena);
+    combinations::pmr::Generator<int> generator(arenaSet, &arena);
+    generator.generate(m);
+    for (auto &comb : generator) {
+      auto expected = lexi.get(cnt);
+      auto got = arenaLexi.get(cnt);
+      if (! std::equal(comb.begin(), comb.end(),
+                       expected.begin(), expected.end()) ||
+          ! std::equal(got.begin(), got.end(),
+                       expected.begin(), expected.end())) {
+        std::cout << "Huge page combination " << cnt << " doesn't match."
+                  << std::endl;
+        return 0;
+      } // if
+      ++cnt;
+    } // for each combination
+  }
+  for (auto backing : {Backing::HUGE_1G, Backing::HUGE_2M,
+                       Backing::TRANSPARENT, Backing::NORMAL}) {
+    if (huge.bytes(backing)) {
+      std::cout << "Huge page mapping not released." << std::endl;
+      return 0;
+    } // if
+  } // for each backing
+  // A mapping below 2M gets normal pages rounded to 4K.
+  void *small = huge.allocate(5000);
+  bool normal = huge.bytes(Backing::NORMAL) == 8192 &&
+    huge.bytes(Backing::HUGE_2M) == 0 && huge.bytes(Backing::TRANSPARENT) == 0;
+  huge.deallocate(small, 5000);
+  if (! normal) {
+    std::cout << "Small mapping not backed by normal pages." << std::endl;
+    return 0;
+  } // if
+  // A mapping below 1G never takes a 1G page, even if preferred.
+  combinations::huge::Resource huge1G(Backing::HUGE_1G, 4096);
+  const size_t bytes = 2 * combinations::huge::PAGE_2M;
+  void *medium = huge1G.allocate(bytes);
+  bool no1G = huge1G.bytes(Backing::HUGE_1G) == 0;
+  huge1G.deallocate(medium, bytes);
+  if (! no1G) {
+    std::cout << "Mapping below 1G backed by a 1G page." << std::endl;
+    return 0;
+  } // if
+  return cnt;
+} // testHugePages
+
+
+//      Function : testTiles
+//      Abstract : Check that the serial and parallel tile traversals
+//      for m = 2 and 3 visit each combination once. Returns the number
+//      of combinations found, or 0 on a mismatch.
+size_t
+testTiles(size_t n, size_t m)
+{
+  using Combs = std::vector<std::vector<int>>;
+  std::vector<int> set(n);
+  std::iota(set.begin(), set.end(), 0);
+  combinations::Lexor<int> lexi(set, m);
+  size_t total = combinations::Counter().count(n, m);
+  auto visit = [](Combs &out) {
+    return [&out](auto... idx) { out.push_back({int(idx)...}); };
+  };
+  for (uint32_t block : {1u, 3u, 64u}) {
+    Combs serial;
+    std::vector<Combs> parallel(4);
+    auto run = [&](auto tag) {
+      constexpr size_t M = decltype(tag)::value;
+      combinations::tiles::forEachTile<M>(
+        n, block, [&](const auto &tile) { tile.forEach(visit(serial)); });
+      combinations::tiles::parallelForEachTile<M>(
+        n, block, [&](const auto &tile, unsigned w) {
+          tile.forEach(visit(parallel[w])); }, 4);
+    };
+    if (m == 2) {
+      run(std::integral_constant<size_t, 2>());
+    } else {
+      run(std::integral_constant<size_t, 3>());
+    } // if
+    Combs merged;
+    for (auto &out : parallel) {
+      merged.insert(merged.end(), out.begin(), out.end());
+    } // for each worker
+    std::sort(serial.begin(), serial.end());
+    std::sort(merged.begin(), merged.end());
+    if (serial.size() != total || merged != serial) {
+      std::cout << "Tiles of " << block << " don't match." << std::endl;
+      return 0;
+    } // if
+    for (size_t i = 0; i < total; ++i) {
+      if (serial[i] != lexi.get(i)) {
+        std::cout << "Tile combination " << i << " doesn't match."
+                  << std::endl;
+        return 0;
+      } // if
+    } // for
+  } // for each block size
+  return total;
+} // testTiles
+
+
+//      Function : testSmallLexor
+//      Abstract : Lexor unranks sets of up to 32 elements by table
+//      lookups. Check some ranks of every subset size at the largest
+//      such set against the unrank kernel.
+bool
+testSmallLexor()
+{
+  const size_t n = combinations::detail::SMALL_N;
+  std::vector<int> set(n);
+  std::iota(set.begin(), set.end(), 0);
+  combinations::Lexor<int> lexi(set, 0);
+  std::vector<uint32_t> idx(n);
+  for (size_t m = 1; m <= n; ++m) {
+    size_t total = combinations::binomial(n, m);
+    for (size_t r : {size_t(0), size_t(1), total / 3, total / 2, total - 1}) {
+      r = std::min(r, total - 1);
+      combinations::kernels::best().unrank(r, total, uint32_t(n),
+                                           uint32_t(m), idx.data());
+      auto comb = lexi.get(r, m);
+      if (comb.size() != m ||
+          ! std::equal(comb.begin(), comb.end(), idx.begin())) {
+        std::cout << "Lexor differs at m=" << m << " rank " << r << std::endl;
+        return false;
+      } // if
+    } // for each rank
+  } // for each m
+  return true;
+} // testSmallLexor
+
+
+//      Function : testKernels
+//      Abstract : Check every kernel variant the host supports against
+//      Lexor. Returns the number of combinations the variants agreed
+//      on, which is zero if any of them disagreed.
+size_t
+testKernels(size_t n, size_t m)
+{
+  COMBINATIONS_TRACE_SCOPE("testKernels");
+  if (m > n) {
+    return 0;
+  } // if
+  std::vector<int> set(n);
+  std::iota(set.begin(), set.end(), 0);
+  combinations::Lexor<int> lexi(set, m);
+  size_t total = combinations::Counter().count(n, m);
+  size_t cnt = 0;
+
+  for (auto kernels : combinations::kernels::variants()) {
+    std::vector<uint32_t> idx(m), ranked(m), batch(m), fromMask(64);
+    std::iota(idx.begin(), idx.end(), 0);
+    std::iota(batch.begin(), batch.end(), 0);
+    // Masks of all combinations and some dense ones with their indices,
+    // on both sides of the sparse thresholds of fromMasks.
+    std::vector<uint64_t> masks{~uint64_t(0), 0x8000000000000001,
+                                0xaaaaaaaaaaaaaaaa, 0x00ff00ff00ff00ff,
+                                0x800000000000000f, 0x8000000000000fff,
+                                0x9000000000000fff, 0x0123456789abcdef};
+    std::vector<uint32_t> indices;
+    for (uint64_t mask : masks) {
+      indices.insert(indices.end(), fromMask.begin(),
+                     fromMask.begin() + kernels->fromMask(mask,
+                                                          fromMask.data()));
+    } // for each mask
+    cnt = 0;
+    do {
+      kernels->unrank(cnt, total, n, m, ranked.data());
+      auto expected = lexi.get(cnt);
+      bool ok = idx == ranked &&
+        std::equal(idx.begin(), idx.end(), expected.begin());
+      if (n <= 64) {
+        uint64_t mask = kernels->toMask(idx.data(), m);
+        ok = ok && kernels->fromMask(mask, fromMask.data()) == m &&
+          std::equal(idx.begin(), idx.end(), fromMask.begin());
+        masks.push_back(mask);
+        indices.insert(indices.end(), idx.begin(), idx.end());
+      } // if
+      if (! ok || (cnt && batch != idx)) {
+        std::cout << kernels->name << " kernels disagree at combination "
+                  << cnt << std::endl;
+        return 0;
+      } // if
+      ++cnt;
+      std::vector<uint32_t> next(m);
+      if (kernels->batch(batch.data(), m, n, next.data(), 1)) {
+        batch = next;
+      } // if
+    } while (kernels->successor(idx.data(), m, n));
+
+    std::vector<uint32_t> decoded(indices.size() +
+                                  combinations::kernels::FROM_MASKS_SLACK);
+    decoded.resize(kernels->fromMasks(masks.data(), masks.size(),
+                                      decoded.data()));
+    if (decoded != indices ||
+        combinations::masksToIndices(masks.data(), masks.size(),
+                                     *kernels) != indices) {
+      std::cout << kernels->name << " mask decoding disagrees" << std::endl;
+      return 0;
+    } // if
+  } // for each variant
+
+  return cnt;
+} // testKernels
+
+
+//      Function : reportAllocs
+//      Abstract : Print the allocations per combination of each
+//      operation. Only meaningful when built with ALLOC_STATS.
+void
+reportAllocs(size_t cnt)
+{
+  if (alloc::enabled && cnt) {
+    std::cout << "Allocations per combination:" << std::endl
+              << "  Enumerator::next    " << nextTally.countPerOp()
+              << " (" << nextTally.bytesPerOp() << " bytes)" << std::endl
+              << "  Lexor::get          " << getTally.countPerOp()
+              << " (" << getTally.bytesPerOp() << " bytes)" << std::endl
+              << "  Generator::generate " << generateTally.countPerOp()/cnt
+              << " (" << generateTally.bytesPerOp()/cnt << " bytes)"
+              << std::endl;
+  } // if
+} // reportAllocs
+
+
 //      Function : main
 //      Abstract : Main driver.
 int
@@ -105,12 +1071,44 @@ main(int argc, char *argv[])
   size_t m = args.m;
   size_t n = args.n;
 
+  if (! args.trace.empty()) {
+    if (combinations::trace::compiled) {
+      combinations::trace::enable(args.trace);
+    } else {
+      std::cout << "Tracing not compiled in; build with make trace."
+                << std::endl;
+    } // if
+  } // if
+
+  VALIDATE(testTable());
+  VALIDATE(testLargeUniverse());
+  VALIDATE(testSmallLexor());
   try {
     size_t cnt(combinations::Counter().count(n, m));
     std::cout << "Count: " << cnt << std::endl;
     if (cnt <= args.limit) {
       VALIDATE(cnt == testEnumerate(n, m, args.printp));
       VALIDATE(cnt == testGenerate(n, m, args.printp));
+      VALIDATE(m == 0 || cnt == testKernels(n, m));
+      VALIDATE(cnt == testCombination(n, m));
+      VALIDATE(cnt == testNextPrev(n, m));
+      VALIDATE(cnt == testPrefixRange(n, m));
+      VALIDATE(cnt == testBestFirst(n, m));
+      VALIDATE(cnt == testSubsetSum(n, m));
+      VALIDATE(testSwaps(n, m));
+      VALIDATE(testAggregates(n, m));
+      VALIDATE(testConstrained(n, m));
+      VALIDATE(testMasks(n, m));
+      VALIDATE(cnt == testArena(n, m));
+      VALIDATE(cnt == testTrie(n, m));
+      VALIDATE(cnt == testHugePages(n, m));
+      if (m > 0 && m <= 8) {
+        VALIDATE(cnt == testFixed(n, m));
+      } // if
+      if (m == 2 || m == 3) {
+        VALIDATE(cnt == testTiles(n, m));
+      } // if
+      reportAllocs(cnt);
     } else {
       std::cout << "Number of subsets exceeds limit." << std::endl;
     } // if
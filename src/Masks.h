@@ -0,0 +1,174 @@
+//
+//      File     : Masks.h
+//      Abstract : Enumeration and ranking of the m-subsets of the set
+//      bits of a 64-bit mask. Subsets are bitmasks too. They are
+//      generated as compact subsets of the low popcount(mask) bits in
+//      colex order, i.e. in increasing numeric order, and scattered
+//      into the mask with PDEP; ranking gathers them back with PEXT.
+//      Both use the BMI2 instructions when the host has them, through
+//      the kernel variants, and a software loop otherwise. Batches of
+//      masks are decoded into flat index lists.
+//
+
+#ifndef MASKS_H
+#define MASKS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "Combinations.h"
+#include "Kernels.h"
+
+namespace combinations {
+
+//      Class    : MaskEnumerator
+//      Abstract : Subsets of mask with m bits, without building a set
+//      of its bit positions. The rank of a subset is its colex rank:
+//      sum_i C(p_i, i+1) over the positions p_0 < p_1 < ... of its
+//      bits within the compacted mask.
+class MaskEnumerator {
+public:
+  MaskEnumerator(uint64_t mask, uint32_t m,
+                 const kernels::KernelTable &kernels =
+                   kernels::best()); // CTOR
+  ~MaskEnumerator() = default; // DTOR
+
+  uint64_t count() const { return binomial(_k, _m); };
+  uint64_t first();
+  bool next(uint64_t &subset);
+  size_t batch(uint64_t *out, size_t maxCnt);
+  uint64_t rank(uint64_t subset) const;
+  uint64_t unrank(uint64_t rank) const;
+
+  MaskEnumerator(const MaskEnumerator &) = delete; // Copy CTOR
+  MaskEnumerator &operator=(const MaskEnumerator &) =
+    delete; // Copy assignment
+  MaskEnumerator(MaskEnumerator &&) = delete; // Move CTOR
+  MaskEnumerator &operator=(MaskEnumerator &&) =
+    delete; // Move assignment
+private:
+  const kernels::KernelTable &_kernels;
+  uint64_t _mask;
+  uint32_t _k; // popcount(mask)
+  uint32_t _m;
+  uint64_t _limit; // Largest compact subset.
+  uint64_t _compact; // Current subset compacted to the low k bits.
+}; // MaskEnumerator
+
+
+//      Function : MaskEnumerator::MaskEnumerator
+//      Abstract : Throws an invalid argument error if m exceeds the
+//      number of set bits.
+inline
+MaskEnumerator::MaskEnumerator(const uint64_t mask, const uint32_t m,
+                               const kernels::KernelTable &kernels) :
+  _kernels(kernels), _mask(mask), _k(uint32_t(__builtin_popcountll(mask))),
+  _m(m), _compact(0)
+{
+  if (_m > _k) {
+    throw std::invalid_argument("Subset size exceeds set size.");
+  } // if
+  _limit = _k == 64 ? UINT64_MAX : (uint64_t(1) << _k) - 1;
+} // MaskEnumerator::MaskEnumerator
+
+
+//      Function : MaskEnumerator::first
+//      Abstract : The lowest m set bits of the mask.
+inline uint64_t
+MaskEnumerator::first()
+{
+  _compact = _m == 64 ? UINT64_MAX : (uint64_t(1) << _m) - 1;
+  return _kernels.deposit(_compact, _mask);
+} // MaskEnumerator::first
+
+
+//      Function : MaskEnumerator::next
+//      Abstract : Set subset to the successor of the current one and
+//      return true, or return false after the last one.
+inline bool
+MaskEnumerator::next(uint64_t &subset)
+{
+  if (! kernels::detail::colexSuccessor(_compact, _limit)) {
+    return false;
+  } // if
+  subset = _kernels.deposit(_compact, _mask);
+  return true;
+} // MaskEnumerator::next
+
+
+//      Function : MaskEnumerator::batch
+//      Abstract : Write up to maxCnt successors to out; fewer at the
+//      end. One dispatched call covers the whole batch.
+inline size_t
+MaskEnumerator::batch(uint64_t *out, const size_t maxCnt)
+{
+  return _compact == 0 ? 0 :
+    _kernels.maskBatch(&_compact, _mask, out, maxCnt);
+} // MaskEnumerator::batch
+
+
+//      Function : MaskEnumerator::rank
+//      Abstract : Compact the subset with PEXT and sum the binomials
+//      of its bit positions. Throws an invalid argument error if the
+//      subset isn't an m-subset of the mask.
+inline uint64_t
+MaskEnumerator::rank(const uint64_t subset) const
+{
+  if ((subset & ~_mask) != 0 ||
+      uint32_t(__builtin_popcountll(subset)) != _m) {
+    throw std::invalid_argument("Not a subset of the mask.");
+  } // if
+  uint64_t compact = _kernels.extract(subset, _mask);
+  uint64_t result = 0;
+  for (size_t i = 1; compact != 0; ++i) {
+    result += binomial(size_t(__builtin_ctzll(compact)), i);
+    compact &= compact - 1;
+  } // for
+  return result;
+} // MaskEnumerator::rank
+
+
+//      Function : MaskEnumerator::unrank
+//      Abstract : The subset of a given colex rank: from the top
+//      position down, take the highest bit p with C(p, i) <= rank.
+inline uint64_t
+MaskEnumerator::unrank(uint64_t rank) const
+{
+  if (rank >= count()) {
+    throw std::out_of_range("Rank exceeds the number of subsets.");
+  } // if
+  uint64_t compact = 0;
+  size_t p = _k;
+  for (size_t i = _m; i > 0; --i) {
+    do {
+      --p;
+    } while (binomial(p, i) > rank);
+    rank -= binomial(p, i);
+    compact |= uint64_t(1) << p;
+  } // for
+  return _kernels.deposit(compact, _mask);
+} // MaskEnumerator::unrank
+
+
+//      Function : masksToIndices
+//      Abstract : The indices of the set bits of each of cnt masks,
+//      one mask after the other, decoded in one batch by the
+//      fromMasks kernel.
+inline std::vector<uint32_t>
+masksToIndices(const uint64_t *masks, const size_t cnt,
+               const kernels::KernelTable &kernels = kernels::best())
+{
+  size_t total = 0;
+  for (size_t i = 0; i < cnt; ++i) {
+    total += size_t(__builtin_popcountll(masks[i]));
+  } // for each mask
+  std::vector<uint32_t> result(total + kernels::FROM_MASKS_SLACK);
+  result.resize(kernels.fromMasks(masks, cnt, result.data()));
+  return result;
+} // masksToIndices
+
+} // namespace combinations
+
+#endif // MASKS_H
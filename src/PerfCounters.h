@@ -0,0 +1,180 @@
+//
+//      File     : PerfCounters.h
+//      Abstract : Hardware performance counters via Linux
+//      perf_event_open. Counters that cannot be opened (non-Linux
+//      hosts, restrictive perf_event_paranoid settings, virtual
+//      machines without a PMU) are reported as unavailable.
+//
+
+#ifndef PERFCOUNTERS_H
+#define PERFCOUNTERS_H
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace perf {
+
+//      Class    : Counters
+//      Abstract : A set of user-space hardware counters (cycles,
+//      instructions, branch misses, cache misses) that are started
+//      and stopped together. Each counter is opened independently so
+//      that one unsupported event does not disable the others.
+class Counters {
+public:
+  enum Event { CYCLES, INSTRUCTIONS, BRANCH_MISSES, CACHE_MISSES, NUM_EVENTS };
+  using Values = std::array<double, NUM_EVENTS>;
+
+  Counters(); // CTOR
+  ~Counters(); // DTOR
+
+  bool available(Event ev) const { return _fds[ev] >= 0; };
+  bool anyAvailable() const;
+  static const char *name(Event ev);
+
+  void start();
+  Values stop(); // Unavailable counters read as -1.
+
+  Counters(const Counters &) = delete; // Copy CTOR
+  Counters &operator=(const Counters &) = delete; // Copy assignment
+  Counters(Counters &&) = delete; // Move CTOR
+  Counters &operator=(Counters &&) = delete; // Move assignment
+private:
+  double read(int fd) const;
+
+  std::array<int, NUM_EVENTS> _fds;
+}; // Counters
+
+
+//      Function : Counters::Counters
+//      Abstract : Open one counter per event, ignoring failures.
+inline
+Counters::Counters()
+{
+  _fds.fill(-1);
+#ifdef __linux__
+  static const uint64_t configs[NUM_EVENTS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_MISSES
+  };
+  for (int ev = 0; ev < NUM_EVENTS; ++ev) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = configs[ev];
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format =
+      PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    _fds[ev] = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+  } // for each event
+#endif
+} // Counters::Counters
+
+
+//      Function : Counters::~Counters
+//      Abstract : Close the open counters.
+inline
+Counters::~Counters()
+{
+#ifdef __linux__
+  for (int fd : _fds) {
+    if (fd >= 0) {
+      close(fd);
+    } // if
+  } // for each counter
+#endif
+} // Counters::~Counters
+
+
+//      Function : Counters::anyAvailable
+//      Abstract : True if at least one counter could be opened.
+inline bool
+Counters::anyAvailable() const
+{
+  for (int fd : _fds) {
+    if (fd >= 0) {
+      return true;
+    } // if
+  } // for each counter
+  return false;
+} // Counters::anyAvailable
+
+
+//      Function : Counters::name
+//      Abstract : Short name of an event for reports.
+inline const char *
+Counters::name(const Event ev)
+{
+  static const char *names[NUM_EVENTS] = {
+    "cycles", "instructions", "branch_misses", "cache_misses"
+  };
+  return names[ev];
+} // Counters::name
+
+
+//      Function : Counters::start
+//      Abstract : Reset and enable all available counters.
+inline void
+Counters::start()
+{
+#ifdef __linux__
+  for (int fd : _fds) {
+    if (fd >= 0) {
+      ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    } // if
+  } // for each counter
+#endif
+} // Counters::start
+
+
+//      Function : Counters::stop
+//      Abstract : Disable the counters and return their values.
+inline auto
+Counters::stop() -> Values
+{
+  Values values;
+  for (int ev = 0; ev < NUM_EVENTS; ++ev) {
+#ifdef __linux__
+    if (_fds[ev] >= 0) {
+      ioctl(_fds[ev], PERF_EVENT_IOC_DISABLE, 0);
+    } // if
+#endif
+    values[ev] = read(_fds[ev]);
+  } // for each event
+  return values;
+} // Counters::stop
+
+
+//      Function : Counters::read
+//      Abstract : Read one counter, scaling for multiplexing. Returns
+//      -1 if the counter is unavailable or never ran.
+inline double
+Counters::read(const int fd) const
+{
+#ifdef __linux__
+  uint64_t buf[3] = {0, 0, 0}; // value, time enabled, time running
+  if (fd >= 0 && ::read(fd, buf, sizeof(buf)) == sizeof(buf) && buf[2]) {
+    return double(buf[0]) * double(buf[1]) / double(buf[2]);
+  } // if
+#else
+  (void) fd;
+#endif
+  return -1.0;
+} // Counters::read
+
+} // namespace perf
+
+#endif // PERFCOUNTERS_H
@@ -0,0 +1,188 @@
+//
+//      File     : SubsetSum.h
+//      Abstract : Meet-in-the-middle search for the m-element subsets
+//      of a weighted set whose weight sum is within a tolerance of a
+//      target. The set is split into two halves whose combinations
+//      are enumerated into flat arrays sorted by sum, which are then
+//      joined with two pointers. Matches are reported as pairs of
+//      ranks within the halves, so combinations are only built on
+//      request.
+//
+
+#ifndef SUBSETSUM_H
+#define SUBSETSUM_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <vector>
+
+#include "Combinations.h"
+#include "TraceScope.h"
+
+namespace combinations {
+
+//      Class    : SubsetSum
+//      Abstract : Elements [0, h) form the left half and [h, n) the
+//      right half, where h = n/2. A subset with k elements on the left
+//      is the pair of the k-subset of the left half and the
+//      (m-k)-subset of the right half, each identified by its
+//      lexicographic rank among the subsets of that size of its half.
+template <class W = int64_t>
+class SubsetSum {
+public:
+  using Weights = std::vector<W>;
+
+  //      Struct   : Match
+  //      Abstract : A subset found by find().
+  struct Match {
+    size_t leftSize;
+    uint64_t leftRank;
+    uint64_t rightRank;
+    W sum;
+  }; // Match
+
+  SubsetSum(const Weights &weights); // CTOR
+  ~SubsetSum() = default; // DTOR
+
+  template <class Fn>
+  size_t find(size_t m, W target, W tolerance, Fn fn);
+  std::vector<size_t> combination(const Match &match, size_t m) const;
+
+  SubsetSum(const SubsetSum &) = delete; // Copy CTOR
+  SubsetSum &operator=(const SubsetSum &) = delete; // Copy assignment
+  SubsetSum(SubsetSum &&) = delete; // Move CTOR
+  SubsetSum &operator=(SubsetSum &&) = delete; // Move assignment
+private:
+  // Sum and rank of one combination of a half.
+  struct Entry {
+    W sum;
+    uint64_t rank;
+  }; // Entry
+
+  void half(size_t begin, size_t end, size_t k, std::vector<Entry> &table);
+  template <class Fn>
+  size_t join(size_t k, W low, W high, Fn &fn);
+
+  const Weights &_weights;
+  std::vector<size_t> _left;
+  std::vector<size_t> _right;
+  std::vector<Entry> _leftTable;
+  std::vector<Entry> _rightTable;
+}; // SubsetSum
+
+
+//      Function : SubsetSum::SubsetSum
+//      Abstract : Split the element indices into the two halves.
+template <class W>
+SubsetSum<W>::SubsetSum(const Weights &weights) :
+  _weights(weights),
+  _left(weights.size() / 2),
+  _right(weights.size() - weights.size() / 2)
+{
+  std::iota(_left.begin(), _left.end(), 0);
+  std::iota(_right.begin(), _right.end(), _left.size());
+} // SubsetSum::SubsetSum
+
+
+//      Function : SubsetSum::find
+//      Abstract : Call fn(match) for every m-subset whose sum is in
+//      [target - tolerance, target + tolerance], grouped by the number
+//      of elements taken from the left half. Returns the number of
+//      matches.
+template <class W>
+template <class Fn>
+size_t
+SubsetSum<W>::find(const size_t m, const W target, const W tolerance, Fn fn)
+{
+  COMBINATIONS_TRACE_SCOPE("SubsetSum::find");
+  size_t found = 0;
+  size_t kMin = m > _right.size() ? m - _right.size() : 0;
+  for (size_t k = kMin; k <= std::min(m, _left.size()); ++k) {
+    half(0, _left.size(), k, _leftTable);
+    half(_left.size(), _weights.size(), m - k, _rightTable);
+    found += join(k, target - tolerance, target + tolerance, fn);
+  } // for each split
+  return found;
+} // SubsetSum::find
+
+
+//      Function : SubsetSum::combination
+//      Abstract : The element indices of a match, in ascending order.
+template <class W>
+std::vector<size_t>
+SubsetSum<W>::combination(const Match &match, const size_t m) const
+{
+  Lexor<size_t> left(_left, match.leftSize);
+  Lexor<size_t> right(_right, m - match.leftSize);
+  std::vector<size_t> result = left.get(match.leftRank);
+  std::vector<size_t> rest = right.get(match.rightRank);
+  result.insert(result.end(), rest.begin(), rest.end());
+  return result;
+} // SubsetSum::combination
+
+
+//      Function : SubsetSum::half
+//      Abstract : Enumerate the k-subsets of elements [begin, end)
+//      with next_combination into a flat table of sums and ranks,
+//      sorted by sum. Successors of indices >= begin stay >= begin,
+//      so stepping within {0,...,end-1} visits just these. The sort
+//      is stable, so equal sums stay in rank order.
+template <class W>
+void
+SubsetSum<W>::half(const size_t begin, const size_t end, const size_t k,
+                   std::vector<Entry> &table)
+{
+  COMBINATIONS_TRACE_SCOPE("SubsetSum::half");
+  table.clear();
+  table.reserve(binomial(end - begin, k));
+  std::vector<size_t> idx(k);
+  std::iota(idx.begin(), idx.end(), begin);
+  uint64_t rank = 0;
+  do {
+    W sum = W();
+    for (size_t i : idx) {
+      sum += _weights[i];
+    } // for each index
+    table.push_back(Entry{sum, rank++});
+  } while (next_combination(idx.begin(), idx.end(), end));
+  std::stable_sort(table.begin(), table.end(),
+                   [](const Entry &a, const Entry &b) {
+                     return a.sum < b.sum; });
+} // SubsetSum::half
+
+
+//      Function : SubsetSum::join
+//      Abstract : Two-pointer join of the tables. As the left sum
+//      grows, the window of right sums in [low - left, high - left]
+//      only moves down, so each pointer passes over the right table
+//      once besides the reported matches.
+template <class W>
+template <class Fn>
+size_t
+SubsetSum<W>::join(const size_t k, const W low, const W high, Fn &fn)
+{
+  COMBINATIONS_TRACE_SCOPE("SubsetSum::join");
+  size_t found = 0;
+  size_t lo = _rightTable.size(); // First entry >= low - left.
+  size_t hi = _rightTable.size(); // First entry > high - left.
+  for (const Entry &left : _leftTable) {
+    while (hi > 0 && _rightTable[hi-1].sum > high - left.sum) {
+      --hi;
+    } // while
+    while (lo > 0 && _rightTable[lo-1].sum >= low - left.sum) {
+      --lo;
+    } // while
+    for (size_t r = lo; r < hi; ++r) {
+      fn(Match{k, left.rank, _rightTable[r].rank,
+               left.sum + _rightTable[r].sum});
+    } // for each match
+    found += hi > lo ? hi - lo : 0;
+  } // for each left entry
+  return found;
+} // SubsetSum::join
+
+} // namespace combinations
+
+#endif // SUBSETSUM_H
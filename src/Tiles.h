@@ -0,0 +1,189 @@
+//
+//      File     : Tiles.h
+//      Abstract : Cache-blocked traversal of all pairs and all triples
+//      of indices in {0,...,n-1}. The index space is cut into tiles
+//      of block x block (x block) indices, and a callback receives
+//      one tile at a time, so the element data of a tile can stay in
+//      L1 or L2 while its combinations are processed. Tiles are
+//      visited serially or handed out to worker threads one task at
+//      a time.
+//
+
+#ifndef TILES_H
+#define TILES_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "TraceScope.h"
+
+namespace combinations {
+namespace tiles {
+
+//      Struct   : Tile
+//      Abstract : The combinations idx[0] < ... < idx[M-1] with each
+//      idx[p] in [begin[p], end[p]). Position ranges are blocks that
+//      are either equal or disjoint and ascending, so every
+//      combination falls in exactly one tile.
+template <size_t M>
+struct Tile {
+  static_assert(M == 2 || M == 3);
+
+  std::array<uint32_t, M> begin;
+  std::array<uint32_t, M> end;
+
+  // Call fn(i, j) or fn(i, j, k) for each combination of the tile.
+  template <class Fn>
+  void forEach(Fn fn) const;
+}; // Tile
+
+
+//      Function : Tile<M>::forEach
+//      Abstract : Visit the combinations of the tile in lexicographic
+//      order. Inner indices start after the outer ones where blocks
+//      coincide.
+template <size_t M>
+template <class Fn>
+void
+Tile<M>::forEach(Fn fn) const
+{
+  for (uint32_t i = begin[0]; i < end[0]; ++i) {
+    for (uint32_t j = std::max(begin[1], i+1); j < end[1]; ++j) {
+      if constexpr (M == 2) {
+        fn(i, j);
+      } else {
+        for (uint32_t k = std::max(begin[2], j+1); k < end[2]; ++k) {
+          fn(i, j, k);
+        } // for
+      } // if
+    } // for
+  } // for
+} // Tile<M>::forEach
+
+
+namespace detail {
+
+//      Function : task
+//      Abstract : Call fn on the tiles whose first M-1 blocks are
+//      given. The last block ranges over the blocks from the
+//      previous one on.
+template <size_t M, class Fn>
+void
+task(const uint32_t n, const uint32_t block,
+     const std::array<uint32_t, M-1> &blocks, Fn &fn)
+{
+  Tile<M> tile;
+  for (size_t p = 0; p+1 < M; ++p) {
+    tile.begin[p] = blocks[p] * block;
+    tile.end[p] = std::min(n, tile.begin[p] + block);
+  } // for
+  for (uint32_t b = blocks[M-2]; b * block < n; ++b) {
+    tile.begin[M-1] = b * block;
+    tile.end[M-1] = std::min(n, tile.begin[M-1] + block);
+    fn(tile);
+  } // for
+} // task
+
+
+//      Function : decode
+//      Abstract : Split a task number into the leading blocks, in
+//      row-major order over nb blocks per position. Returns false for
+//      numbers whose blocks are not ascending, which are skipped.
+template <size_t M>
+bool
+decode(size_t t, const uint32_t nb, std::array<uint32_t, M-1> &blocks)
+{
+  for (size_t p = M-1; p-- > 0;) {
+    blocks[p] = uint32_t(t % nb);
+    t /= nb;
+  } // for
+  return std::is_sorted(blocks.begin(), blocks.end());
+} // decode
+
+
+//      Function : taskCount
+//      Abstract : Number of task numbers, ascending or not.
+template <size_t M>
+size_t
+taskCount(const uint32_t nb)
+{
+  return M == 2 ? size_t(nb) : size_t(nb) * nb;
+} // taskCount
+
+} // namespace detail
+
+
+//      Function : forEachTile
+//      Abstract : Call fn(tile) for every tile of M-element index
+//      combinations of {0,...,n-1} with block indices per position,
+//      in lexicographic order of the blocks.
+template <size_t M, class Fn>
+void
+forEachTile(const uint32_t n, const uint32_t block, Fn fn)
+{
+  COMBINATIONS_TRACE_SCOPE("tiles::forEachTile");
+  if (block == 0) {
+    throw std::invalid_argument("Tile block must be positive.");
+  } // if
+  const uint32_t nb = (n + block - 1) / block;
+  std::array<uint32_t, M-1> blocks;
+  for (size_t t = 0; t < detail::taskCount<M>(nb); ++t) {
+    if (detail::decode<M>(t, nb, blocks)) {
+      detail::task<M>(n, block, blocks, fn);
+    } // if
+  } // for each task
+} // forEachTile
+
+
+//      Function : parallelForEachTile
+//      Abstract : As forEachTile, but tasks of tiles sharing their
+//      leading blocks are taken by worker threads from a shared
+//      counter, and fn(tile, worker) also receives the worker number
+//      in [0, threads). Tiles are processed in no particular order
+//      and fn must be safe to call concurrently. Zero threads means
+//      one per hardware thread.
+template <size_t M, class Fn>
+void
+parallelForEachTile(const uint32_t n, const uint32_t block, Fn fn,
+                    unsigned threads = 0)
+{
+  COMBINATIONS_TRACE_SCOPE("tiles::parallelForEachTile");
+  if (block == 0) {
+    throw std::invalid_argument("Tile block must be positive.");
+  } // if
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  } // if
+  const uint32_t nb = (n + block - 1) / block;
+  std::atomic<size_t> nextTask(0);
+  auto worker = [&](unsigned w) {
+    COMBINATIONS_TRACE_SCOPE("tiles::worker");
+    auto call = [&](const Tile<M> &tile) { fn(tile, w); };
+    std::array<uint32_t, M-1> blocks;
+    for (size_t t = nextTask++; t < detail::taskCount<M>(nb); t = nextTask++) {
+      if (detail::decode<M>(t, nb, blocks)) {
+        detail::task<M>(n, block, blocks, call);
+      } // if
+    } // for each task
+  };
+
+  std::vector<std::thread> pool;
+  for (unsigned w = 1; w < threads; ++w) {
+    pool.emplace_back(worker, w);
+  } // for
+  worker(0);
+  for (auto &thread : pool) {
+    thread.join();
+  } // for each thread
+} // parallelForEachTile
+
+} // namespace tiles
+} // namespace combinations
+
+#endif // TILES_H
@@ -0,0 +1,204 @@
+//
+//      File     : Trace.h
+//      Abstract : Opt-in tracing of scoped spans, written as a Chrome
+//      trace-event JSON file (chrome://tracing, Perfetto) at exit.
+//      Spans are only recorded when COMBINATIONS_TRACE is defined at
+//      compile time; the library headers open them through
+//      TraceScope.h, which includes this header only then. Each
+//      thread appends to its own buffer, so recording takes no locks
+//      after a thread's first span.
+//
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace combinations {
+namespace trace {
+
+#ifdef COMBINATIONS_TRACE
+constexpr bool compiled = true;
+#else
+constexpr bool compiled = false;
+#endif
+
+//      Struct   : Event
+//      Abstract : A completed span. Times are in ns since enable().
+struct Event {
+  const char *name;
+  int64_t start;
+  int64_t duration;
+}; // Event
+
+
+//      Struct   : Buffer
+//      Abstract : Events of one thread. Only the owning thread
+//      appends; the buffer is read when the trace is written.
+struct Buffer {
+  uint32_t tid;
+  std::vector<Event> events;
+}; // Buffer
+
+
+//      Class    : Recorder
+//      Abstract : Process-wide trace state: the output file, the
+//      clock epoch and the per-thread buffers.
+class Recorder {
+public:
+  static Recorder &instance();
+
+  void enable(const std::string &file);
+  bool enabled() const { return _enabled.load(std::memory_order_relaxed); };
+  int64_t now() const;
+  Buffer &local();
+  void write();
+
+  Recorder(const Recorder &) = delete; // Copy CTOR
+  Recorder &operator=(const Recorder &) = delete; // Copy assignment
+  Recorder(Recorder &&) = delete; // Move CTOR
+  Recorder &operator=(Recorder &&) = delete; // Move assignment
+private:
+  Recorder() = default; // CTOR
+  ~Recorder() = default; // DTOR
+
+  std::atomic<bool> _enabled = false;
+  std::chrono::steady_clock::time_point _epoch;
+  std::string _file;
+  std::mutex _mutex;
+  std::vector<std::shared_ptr<Buffer>> _buffers;
+}; // Recorder
+
+
+//      Class    : Span
+//      Abstract : Records an event covering its lifetime if tracing
+//      is enabled when it is constructed. The name must outlive the
+//      trace, e.g. a string literal.
+class Span {
+public:
+  Span(const char *name) :
+    _name(name),
+    _start(Recorder::instance().enabled() ? Recorder::instance().now() : -1)
+  {}; // CTOR
+  ~Span(); // DTOR
+
+  Span(const Span &) = delete; // Copy CTOR
+  Span &operator=(const Span &) = delete; // Copy assignment
+  Span(Span &&) = delete; // Move CTOR
+  Span &operator=(Span &&) = delete; // Move assignment
+private:
+  const char *_name;
+  int64_t _start;
+}; // Span
+
+
+//      Function : enable
+//      Abstract : Start tracing; the trace is written to file at exit.
+inline void
+enable(const std::string &file)
+{
+  Recorder::instance().enable(file);
+} // enable
+
+
+//      Function : Recorder::instance
+//      Abstract : The process-wide recorder.
+inline Recorder &
+Recorder::instance()
+{
+  static Recorder recorder;
+  return recorder;
+} // Recorder::instance
+
+
+//      Function : Recorder::enable
+//      Abstract : Reset the epoch, remember the output file and
+//      arrange for the trace to be written at exit.
+inline void
+Recorder::enable(const std::string &file)
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  _file = file;
+  _epoch = std::chrono::steady_clock::now();
+  if (! _enabled.exchange(true)) {
+    std::atexit([]() { Recorder::instance().write(); });
+  } // if
+} // Recorder::enable
+
+
+//      Function : Recorder::now
+//      Abstract : Nanoseconds since tracing was enabled.
+inline int64_t
+Recorder::now() const
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now() - _epoch).count();
+} // Recorder::now
+
+
+//      Function : Recorder::local
+//      Abstract : The calling thread's buffer, registered on first use.
+inline Buffer &
+Recorder::local()
+{
+  thread_local std::shared_ptr<Buffer> buffer;
+  if (! buffer) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    buffer = std::make_shared<Buffer>();
+    buffer->tid = _buffers.size();
+    _buffers.push_back(buffer);
+  } // if
+  return *buffer;
+} // Recorder::local
+
+
+//      Function : Recorder::write
+//      Abstract : Write all buffers as Chrome trace events, with times
+//      in microseconds to the nanosecond. Threads should have finished
+//      recording by now.
+inline void
+Recorder::write()
+{
+  std::lock_guard<std::mutex> lock(_mutex);
+  std::ofstream out(_file);
+  out << std::fixed << std::setprecision(3);
+  out << "{\"traceEvents\": [";
+  const char *sep = "\n";
+  for (const auto &buffer : _buffers) {
+    for (const auto &event : buffer->events) {
+      out << sep << "  {\"name\": \"" << event.name << "\""
+          << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->tid
+          << ", \"ts\": " << event.start / 1e3
+          << ", \"dur\": " << event.duration / 1e3 << "}";
+      sep = ",\n";
+    } // for each event
+  } // for each buffer
+  out << "\n], \"displayTimeUnit\": \"ns\"}\n";
+} // Recorder::write
+
+
+//      Function : Span::~Span
+//      Abstract : Append the completed span to the thread's buffer.
+inline
+Span::~Span()
+{
+  if (_start >= 0) {
+    Recorder &recorder = Recorder::instance();
+    recorder.local().events.push_back(
+      Event{_name, _start, recorder.now() - _start});
+  } // if
+} // Span::~Span
+
+} // namespace trace
+} // namespace combinations
+
+#endif // TRACE_H
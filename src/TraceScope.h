@@ -0,0 +1,23 @@
+//
+//      File     : TraceScope.h
+//      Abstract : The COMBINATIONS_TRACE_SCOPE macro used by the
+//      library headers. It pulls in the recorder of Trace.h only when
+//      COMBINATIONS_TRACE is defined at compile time; otherwise it
+//      expands to nothing and this header includes nothing.
+//
+
+#ifndef TRACE_SCOPE_H
+#define TRACE_SCOPE_H
+
+#ifdef COMBINATIONS_TRACE
+#include "Trace.h"
+
+#define COMBINATIONS_TRACE_CAT2(a, b) a##b
+#define COMBINATIONS_TRACE_CAT(a, b) COMBINATIONS_TRACE_CAT2(a, b)
+#define COMBINATIONS_TRACE_SCOPE(name) \
+  ::combinations::trace::Span COMBINATIONS_TRACE_CAT(traceSpan, __LINE__)(name)
+#else
+#define COMBINATIONS_TRACE_SCOPE(name) do {} while (0)
+#endif
+
+#endif // TRACE_SCOPE_H